@@ -0,0 +1,10 @@
+#ifndef CRC8_H_
+#define CRC8_H_
+
+//==================== Function Prototypes ====================
+
+// CRC-8, polynomial 0x07, initial value 0
+unsigned char crc8Update(unsigned char crc, unsigned char data);
+unsigned char crc8(const unsigned char *data, unsigned char length);
+
+#endif /* CRC8_H_ */
@@ -0,0 +1,60 @@
+#ifndef EVENTLOG_H_
+#define EVENTLOG_H_
+
+#include "tagUID.h"
+
+/*
+  Access event log.
+
+  Every decision is appended as a record to a RAM ring. Once
+  EVENTLOG_BATCH records are waiting, or the oldest has waited
+  EVENTLOG_FLUSH_AGE ms, up to EVENTLOG_FRAME_RECORDS of them, as many as
+  fit, are sent together as one FRAME_EVENTS frame:
+
+    sequence (2) | dropped (1) | count x record
+
+  Record, 7 bytes and the UID, multi-byte values LSB first:
+
+    time (4)      ms since power-up
+    info (1)      event (low nibble), UID size (high nibble)
+    latency (1)   ms from the Tag entering the field to the decision, saturating
+    reader (1)    reader the Tag was presented at, EVENTLOG_NO_READER if none
+    UID (size)    all bytes of the UID in the order the Tag sends them, so
+                  UIDs of 7 and 10 bytes that share the first four stay
+                  apart; without a UID (size 0) its head instead, 4 bytes
+
+  sequence counts frames so the receiver notices lost ones, dropped
+  counts records overwritten before they could be sent.
+  tools/decode.py turns a capture of the serial line back into text.
+*/
+
+//==================== Defines ====================
+
+#define EVENTLOG_ENTRIES 16
+#define EVENTLOG_BATCH 4
+#define EVENTLOG_FRAME_RECORDS 8
+#define EVENTLOG_FLUSH_AGE 2000
+#define EVENTLOG_RECORD_HEADER 7
+#define EVENTLOG_RECORD_MAX (EVENTLOG_RECORD_HEADER + UID_MAX_SIZE)
+
+#define EVENTLOG_NO_READER 0xFF
+
+/*Events*/
+#define EVENT_GRANT 0x1
+#define EVENT_DENY 0x2
+#define EVENT_MASTER_SET 0x3
+#define EVENT_MASTER_ACCEPT 0x4
+#define EVENT_MASTER_REJECT 0x5
+#define EVENT_ADD 0x6
+#define EVENT_ADD_FULL 0x7
+#define EVENT_REMOVE 0x8
+#define EVENT_RESET_WHITELIST 0x9
+#define EVENT_RESET_MASTER 0xA
+#define EVENT_PROVISION 0xB       // Serial provisioning session ended, head holds the UIDs applied
+
+//==================== Function Prototypes ====================
+
+void eventLog(unsigned char event, unsigned char reader, const tagUID_t *UID, unsigned long latency);
+void eventLogUpdate();
+
+#endif /* EVENTLOG_H_ */
@@ -0,0 +1,57 @@
+#ifndef FRAMTABLE_H_
+#define FRAMTABLE_H_
+
+#include "hal.h"
+#include "tagUID.h"
+
+/*
+  Whitelist kept on the external SPI FRAM, used with WHITELIST_FRAM.
+
+  The chip is split into 64 byte pages, hashed by uidKey(): a UID lives in
+  its home page or, if that page was full, in one of the following ones.
+  A page that ever sent an insert on to the next one is marked, so a
+  lookup reads the home page and only goes on while pages are marked; at
+  the intended fill of at most 80% nearly every lookup reads one page.
+
+    header (4)     used entries (bit per entry), overflow mark, page mark (2)
+    5 x entry (12) UID size, UID bytes as reported by the reader, padding
+
+  Entries are written first and then committed by setting their bit in
+  the used byte, so a write cut off by power loss leaves no half entry.
+  The page mark (page number ^ FRAM_PAGE_MARK) tells a formatted chip;
+  the one of the last page is written by framTableCommit, after the table
+  was filled from the store, so a fill cut off by power loss starts over.
+
+  Pages read are kept in a small RAM cache, writes go through it.
+*/
+
+//==================== Defines ====================
+
+#define FRAM_PAGE_SIZE 64
+#define FRAM_PAGE_BITS 11
+#define FRAM_PAGES (1U << FRAM_PAGE_BITS)
+#define FRAM_PAGE_ENTRIES 5
+#define FRAM_ENTRY_SIZE 12
+#define FRAM_HEADER_SIZE 4
+#define FRAM_TABLE_ENTRIES (FRAM_PAGES * FRAM_PAGE_ENTRIES)
+
+#define FRAM_PAGE_MARK 0xA55A
+
+/*Pages kept in RAM*/
+#define FRAM_CACHE_PAGES 4
+
+#if FRAM_PAGES * FRAM_PAGE_SIZE > HAL_FRAM_SIZE
+#error "FRAM table larger than the chip"
+#endif
+
+//==================== Function Prototypes ====================
+
+bool framTableBegin();
+void framTableFormat();
+void framTableCommit();
+bool framTableFind(const tagUID_t *UID);
+bool framTableInsert(const tagUID_t *UID);
+bool framTableDelete(const tagUID_t *UID);
+unsigned int framTableCount();
+
+#endif /* FRAMTABLE_H_ */
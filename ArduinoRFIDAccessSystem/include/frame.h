@@ -0,0 +1,51 @@
+#ifndef FRAME_H_
+#define FRAME_H_
+
+/*
+  Binary frames on the serial line, sent without blocking the loop.
+
+    0x7E | type | length | payload (length bytes) | CRC-8 over type..payload
+
+  Only one frame is in flight at a time; frameUpdate() hands as many
+  bytes to the UART as its transmit buffer takes, once per loop tick.
+
+  Frames from the host are assembled byte by byte by frameReceive(). They
+  must fit into the 64 byte receive buffer of the UART, so their payload
+  is limited to FRAME_RX_PAYLOAD_MAX. A frame with a longer length, or
+  one that stays incomplete for FRAME_RX_GAP ms, is dropped and the
+  receiver waits for the next sync byte.
+*/
+
+//==================== Defines ====================
+
+#define FRAME_SYNC 0x7E
+#define FRAME_HEADER_SIZE 3
+#define FRAME_PAYLOAD_MAX 100
+#define FRAME_RX_PAYLOAD_MAX 60
+
+/*Silence in ms that ends a partial frame, the loop reads the UART every tick*/
+#define FRAME_RX_GAP 50
+
+/*Frame types*/
+#define FRAME_TELEMETRY 0x01
+#define FRAME_EVENTS 0x02
+#define FRAME_PROVISION_ACK 0x03
+#define FRAME_STATUS 0x04
+
+/*Frame types sent by the host*/
+#define FRAME_PROVISION_BEGIN 0x10
+#define FRAME_PROVISION_ADD 0x11
+#define FRAME_PROVISION_REMOVE 0x12
+#define FRAME_PROVISION_END 0x13
+
+//==================== Function Prototypes ====================
+
+unsigned char *frameStart(unsigned char type);
+void frameFinish(unsigned char length);
+void frameUpdate();
+bool frameBusy();
+bool frameReceive(unsigned char data);
+bool frameReceiving();
+const unsigned char *frameReceived(unsigned char *type, unsigned char *length);
+
+#endif /* FRAME_H_ */
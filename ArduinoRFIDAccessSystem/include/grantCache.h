@@ -0,0 +1,33 @@
+#ifndef GRANTCACHE_H_
+#define GRANTCACHE_H_
+
+#include "tagUID.h"
+
+/*
+  Recently granted UIDs, kept in RAM in front of the Whitelist lookup.
+
+  A few people badge in all day; a hit answers their lookup without the
+  Bloom filter, the hash table or the EEPROM and FRAM reads behind it.
+  Entries are replaced by the CLOCK algorithm: a hit sets the reference
+  bit of its entry, the hand clears set bits as it passes and replaces
+  the first entry without one.
+
+  Only members may be held: every way a UID leaves the Whitelist has to
+  call grantCacheRemove() or grantCacheClear(). Hits and misses are
+  counted for the status frame, see telemetry.h.
+*/
+
+//==================== Defines ====================
+
+#define GRANT_CACHE_ENTRIES 8
+
+//==================== Function Prototypes ====================
+
+bool grantCacheFind(const tagUID_t *UID);
+void grantCacheAdd(const tagUID_t *UID);
+void grantCacheRemove(const tagUID_t *UID);
+void grantCacheClear();
+void grantCacheStats(unsigned long *hits, unsigned long *misses);
+bool grantCacheEntry(unsigned char entry, tagUID_t *UID);
+
+#endif /* GRANTCACHE_H_ */
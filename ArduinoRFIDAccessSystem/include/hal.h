@@ -0,0 +1,121 @@
+#ifndef HAL_H_
+#define HAL_H_
+
+#include <stdint.h>
+#include "tagUID.h"
+
+/*
+  Hardware abstraction for the access system.
+
+  src/hal_avr.cpp drives the real parts (MFRC522, EEPROM, Timer1, SK6812,
+  optional SPI FRAM)
+  and is built for the Arduino environment. src/hal_native.cpp simulates
+  them on the host and runs the application against a badge trace read
+  from stdin, see the [env:native] environment in platformio.ini.
+*/
+
+#ifdef ARDUINO
+
+#include <Arduino.h>
+#include "../lib/Arduino_SK6812/SK6812.h"
+
+#else
+
+#include <string.h>
+
+/*Arduino types and PROGMEM access, flash and RAM are the same on the host*/
+typedef uint8_t byte;
+
+#define PROGMEM
+#define memcpy_P memcpy
+#define pgm_read_byte(address) (*(const uint8_t *)(address))
+
+/*Pixel layout of the SK6812 library*/
+struct RGBW {
+  uint8_t g;
+  uint8_t r;
+  uint8_t b;
+  uint8_t w;
+};
+
+#endif
+
+//==================== Defines ====================
+
+/*MFRC522 readers on the shared SPI bus, each with its own chip select,
+  build flags may override*/
+#ifndef HAL_READERS
+#define HAL_READERS 1
+#endif
+
+/*Data pin of the signal LED chain, fixed at build time for the SK6812 driver;
+  HAL_LED_USART drives the chain from USART1 of a Mega board instead*/
+#ifndef HAL_LED_PIN
+#define HAL_LED_PIN 15
+#endif
+
+//==================== Function Prototypes ====================
+
+// Clock
+unsigned long halMillis();
+unsigned long halMicros();
+void halTickBegin(unsigned int period);
+void halTickWait();
+
+// GPIO and buzzer
+void halPinOutput(unsigned char pin);
+void halPinWrite(unsigned char pin, bool high);
+void halTone(unsigned char pin, unsigned int frequency);
+void halNoTone(unsigned char pin);
+
+// Signal LED chain, a pixel per reader; a color already shown is not sent again
+void halLedBegin();
+void halLedShow(unsigned char pixel, RGBW color);
+void halLedStats(unsigned long *sent, unsigned long *elided);
+
+// Free SRAM between heap and stack in bytes, 0 where unknown: the least since halRamMark(), which
+// fills it with a pattern the stack overwrites as it grows
+void halRamMark();
+unsigned int halFreeRam();
+
+// Serial line, carries binary frames
+void halSerialBegin();
+int halSerialRead();
+unsigned int halSerialWrite(const unsigned char *data, unsigned int length);
+
+// EEPROM, writes skip cells that already hold the value
+void halEepromRead(unsigned int address, void *data, unsigned int length);
+void halEepromWrite(unsigned int address, const void *data, unsigned int length);
+
+// External SPI FRAM (MB85RS1MT), shares the bus with the reader
+#define HAL_FRAM_SIZE 0x20000UL
+
+void halFramBegin();
+void halFramRead(unsigned long address, void *data, unsigned int length);
+void halFramWrite(unsigned long address, const void *data, unsigned int length);
+
+// Benchmark counters, only kept by the simulator
+#define HAL_COUNT_LOOKUP 0          // Whitelist lookups
+#define HAL_COUNT_BLOOM_REJECT 1    // Lookups answered by the Bloom filter alone
+#define HAL_COUNT_BLOOM_FALSE 2     // Lookups the Bloom filter passed for a non-member
+#define HAL_COUNT_PROBE 3           // Hash table slots probed, FRAM pages with WHITELIST_FRAM
+#define HAL_COUNT_GRANT_LOOKUP 4    // Badges checked for access
+#define HAL_COUNT_GRANT_HIT 5       // Of those answered by the grant cache
+#define HAL_COUNT_STORE_APPEND 6    // Store appends, each starts an operation a power cut may interrupt
+#define HAL_COUNTERS 7
+
+#ifdef ARDUINO
+#define halCount(counter)
+#else
+void halCount(unsigned char counter);
+#endif
+
+// RFID readers, numbered from 0
+void halReaderBegin();
+bool halReaderWakeup(unsigned char reader);
+void halReaderHalt(unsigned char reader);
+bool halReaderSelect(unsigned char reader, tagUID_t *UID);
+bool halReaderReadBlock(unsigned char reader, unsigned char block, unsigned char *data);
+void halReaderRelease(unsigned char reader);
+
+#endif /* HAL_H_ */
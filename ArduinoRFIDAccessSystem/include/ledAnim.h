@@ -0,0 +1,69 @@
+#ifndef LEDANIM_H_
+#define LEDANIM_H_
+
+#include "hal.h"
+
+/*
+  LED animations played from keyframes in flash, and the gamma and
+  brightness table every color passes on its way to the LED.
+
+  Colors are perceived levels 0-255 per channel. ledColor() maps them to
+  LED values through ledLevels[], gamma 2 scaled to LED_BRIGHTNESS,
+  generated at compile time into flash.
+
+  A keyframe holds a color and how long the fade to it takes; the player
+  fades linearly from the previous keyframe, a keyframe of the same color
+  holds it, and the animation loops. LED_KEYFRAME() stores the reciprocal
+  of the duration with it, so a frame costs per channel one multiplication
+  and no division on the 8-bit AVR. ledAnimFrame() is called from the loop
+  tick and catches up on keyframes that passed meanwhile.
+*/
+
+//==================== Defines ====================
+
+/*LED value of a full channel, build flags may override*/
+#ifndef LED_BRIGHTNESS
+#define LED_BRIGHTNESS 100
+#endif
+
+/*Keyframe of duration ms (1-65535) fading to the color c0-c3, in the order of the RGBW fields;
+  the first channel lights red on the strip of this board, see color_red in main.cpp*/
+#define LED_KEYFRAME(c0, c1, c2, c3, duration) {{c0, c1, c2, c3}, duration, 65535U / (duration)}
+
+/*Animation from an array of keyframes*/
+#define LED_ANIMATION(frames) {frames, sizeof(frames) / sizeof(ledKeyframe_t)}
+
+//==================== Objects ====================
+
+/*struct for a keyframe in flash*/
+typedef struct
+{
+  RGBW color;
+  uint16_t duration;       // Fade to color in ms
+  uint16_t rate;           // 65535 / duration
+} ledKeyframe_t;
+
+/*struct for an animation in flash*/
+typedef struct
+{
+  const ledKeyframe_t *frames;
+  unsigned char length;
+} ledAnimation_t;
+
+/*struct for a playing animation*/
+typedef struct
+{
+  const ledKeyframe_t *frames;
+  unsigned char length;
+  unsigned char index;     // Keyframe faded to
+  unsigned long start;     // Start of that fade in ms
+  RGBW from;               // Color the fade starts from
+} ledAnim_t;
+
+//==================== Function Prototypes ====================
+
+RGBW ledColor(RGBW color);
+void ledAnimStart(ledAnim_t *anim, const ledAnimation_t *animation, unsigned long now);
+RGBW ledAnimFrame(ledAnim_t *anim, unsigned long now);
+
+#endif /* LEDANIM_H_ */
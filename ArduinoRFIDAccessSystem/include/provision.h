@@ -0,0 +1,56 @@
+#ifndef PROVISION_H_
+#define PROVISION_H_
+
+#include "tagUID.h"
+
+/*
+  Bulk Whitelist provisioning over the serial line.
+
+  The host sends frames (see frame.h) and waits for the FRAME_PROVISION_ACK
+  of each before sending the next, so no frame ever waits in the receive
+  buffer of the UART while the EEPROM is written:
+
+    FRAME_PROVISION_BEGIN    flags            Starts a session, PROVISION_REPLACE empties the Whitelist first
+    FRAME_PROVISION_ADD      batch | UIDs     Adds the UIDs
+    FRAME_PROVISION_REMOVE   batch | UIDs     Removes the UIDs
+    FRAME_PROVISION_END                       Ends the session
+
+  Each UID is sent as size | bytes. Frames are only taken while keying is
+  open, i.e. after the Master was presented. Every UID is appended to the
+  store as its own record, so a session cut off halfway keeps all batches
+  acknowledged so far; sending a batch twice does no harm.
+
+  Acknowledge, counts and time since FRAME_PROVISION_BEGIN:
+
+    type | batch | status | applied (2) | failed (2) | elapsed ms (4)
+
+  applied counts the UIDs added and the members removed, a UID removed
+  that was no member is neither applied nor failed. applied / elapsed
+  gives the throughput, see tools/provision.py.
+*/
+
+//==================== Defines ====================
+
+/*FRAME_PROVISION_BEGIN flags*/
+#define PROVISION_REPLACE 0x01
+
+/*Acknowledge status*/
+#define PROVISION_OK 0
+#define PROVISION_LOCKED 1      // Keying is not open
+#define PROVISION_MALFORMED 2   // Nothing applied
+#define PROVISION_FULL 3        // Some UIDs did not fit into the Whitelist
+
+#define PROVISION_ACK_SIZE 11
+
+//==================== Function Prototypes ====================
+
+bool provisionFrame(bool unlocked);
+void provisionUpdate();
+
+// Provided by the application
+bool provisionAdd(const tagUID_t *UID);
+bool provisionRemove(const tagUID_t *UID);
+void provisionClear();
+void provisionDone(unsigned int applied);
+
+#endif /* PROVISION_H_ */
@@ -0,0 +1,70 @@
+#ifndef STORE_H_
+#define STORE_H_
+
+#include <stdint.h>
+#include "tagUID.h"
+
+/*
+  Append-only record store spread over the whole EEPROM.
+
+  Every change (user added/removed, whitelist cleared, master set) is
+  appended as an 8-byte record with sequence number and CRC; UIDs longer
+  than 5 bytes continue in a second record. Writes rotate through all
+  slots, so no cell is rewritten more often than the others. Before a slot
+  is reused, a record that is still needed is copied forward. A record cut
+  off by power loss fails its CRC and is skipped on replay.
+
+  An EEPROM without the magic is converted once by storeConvert: the
+  records of the layout before the store (single-slot ones only) are
+  written around the cells they are read from, the magic goes last.
+*/
+
+//==================== Defines ====================
+
+/*EEPROM area used by the store*/
+#define STORE_ADDRESS_MAGIC 0x000
+#define STORE_BEGIN 0x004
+#define STORE_END 0x400
+
+#define STORE_SLOT_SIZE 8
+#define STORE_SLOTS ((STORE_END - STORE_BEGIN) / STORE_SLOT_SIZE)
+
+/*Record operations*/
+#define STORE_OP_ADD 0x1
+#define STORE_OP_REMOVE 0x2
+#define STORE_OP_CLEAR 0x3
+#define STORE_OP_MASTER 0x4
+#define STORE_OP_EXT 0x5
+
+/*Slots taken by a record holding a UID of the given size*/
+#define STORE_RECORD_SLOTS(size) ((size) > 5 ? 2 : 1)
+/*Slots kept free behind the newest record to copy the largest record forward*/
+#define STORE_RESERVE 2
+
+//==================== Objects ====================
+
+typedef struct
+{
+  unsigned char op;
+  tagUID_t UID;
+} storeRecord_t;
+
+//==================== Function Prototypes ====================
+
+bool storeBegin();
+void storeConvert(unsigned char first);
+void storeReplay();
+bool storeAppend(const storeRecord_t *record);
+bool storeHolds(const tagUID_t *UID);
+void storeMaster(tagUID_t *UID);
+bool storeRecordAt(unsigned char slot, storeRecord_t *record);
+
+// Provided by the application, slot is where the record starts
+void storeRecordApply(const storeRecord_t *record, unsigned char slot);
+bool storeRecordLive(const storeRecord_t *record);
+void storeRecordPlaced(const storeRecord_t *record, unsigned char slot);
+// Provided by the application, the records to convert in order, 0 after the last; the ones from index
+// STORE_SLOTS - first on are read while the lower slots are written, their cells have to lie above those
+bool storeRecordLegacy(unsigned char index, storeRecord_t *record);
+
+#endif /* STORE_H_ */
@@ -0,0 +1,31 @@
+#ifndef TAGUID_H_
+#define TAGUID_H_
+
+#include <stdint.h>
+
+//==================== Defines ====================
+
+/*Longest UID of ISO 14443-3 Tags (triple size)*/
+#define UID_MAX_SIZE 10
+/*UID bytes beyond the packed head*/
+#define UID_TAIL_SIZE (UID_MAX_SIZE - 4)
+
+//==================== Objects ====================
+
+/*struct for Tag UIDs of 4, 7 or 10 bytes*/
+typedef struct
+{
+  unsigned long head;                 // Bytes 0-3, byte 0 most significant
+  unsigned char size;                 // 4, 7 or 10, 0 for no UID
+  unsigned char tail[UID_TAIL_SIZE];  // Bytes 4-9, unused bytes are 0
+} tagUID_t;
+
+//==================== Function Prototypes ====================
+
+void uidSet(tagUID_t *UID, const unsigned char *bytes, unsigned char size);
+void uidClear(tagUID_t *UID);
+unsigned char uidBytes(const tagUID_t *UID, unsigned char *bytes);
+bool uidEqual(const tagUID_t *a, const tagUID_t *b);
+unsigned long uidKey(const tagUID_t *UID);
+
+#endif /* TAGUID_H_ */
@@ -0,0 +1,55 @@
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+/*
+  Duration probes around the hot path, kept in a RAM ring.
+
+  telemetryStart() takes a time stamp, telemetryStop() records the time
+  since then for a probe. The newest TELEMETRY_SAMPLES samples are kept;
+  on request they are sent as one FRAME_TELEMETRY frame once the serial
+  line is free, oldest first:
+
+    count | dropped | count x (probe, duration in us LSB first)
+
+  dropped counts samples overwritten since the last dump. Durations
+  saturate at 65535 us.
+
+  telemetryBoot() records how long loading the Whitelist took, the least
+  free SRAM during setup (converting an old EEPROM included) and the
+  number of members loaded. They are sent once after boot and on request
+  as one FRAME_STATUS frame, together with the grant cache and LED
+  counters since power-up, all LSB first:
+
+    boot time in us (4) | free SRAM in bytes (2) | members (2)
+    grant cache hits (4) | grant cache misses (4)
+    LED syncs sent (4) | LED syncs elided as unchanged (4)
+*/
+
+//==================== Defines ====================
+
+#define TELEMETRY_SAMPLES 32
+
+/*Serial bytes requesting a dump and the status*/
+#define TELEMETRY_REQUEST 'T'
+#define TELEMETRY_STATUS_REQUEST 'S'
+
+#define TELEMETRY_STATUS_SIZE 24
+
+/*Probes*/
+#define TELEMETRY_TAG_PRESENT 1
+#define TELEMETRY_READ_TAG 2
+#define TELEMETRY_LOOKUP 3
+#define TELEMETRY_STORE 4
+#define TELEMETRY_LED 5
+
+//==================== Function Prototypes ====================
+
+unsigned long telemetryStart();
+void telemetryStop(unsigned char probe, unsigned long start);
+void telemetryDump();
+bool telemetrySendDump();
+void telemetryBoot(unsigned long start, unsigned int members);
+void telemetryStatus();
+void telemetryUpdate();
+
+#endif /* TELEMETRY_H_ */
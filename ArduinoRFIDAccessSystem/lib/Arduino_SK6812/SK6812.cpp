@@ -3,13 +3,17 @@
 
 SK6812::SK6812(uint16_t num_leds)
 {
-	_count_led = num_leds;
-	_pixels = (RGBW *)malloc(_count_led * sizeof(RGBW));
+	_store.pixels = (RGBW *)malloc(num_leds * sizeof(RGBW));
+	// Without heap left the chain stays dark and set_rgbw() reports every index as invalid
+	_store.count = _store.pixels != NULL ? num_leds : 0;
+
+	// The LEDs are in an unknown state, the first sync sends all of them
+	_dirty_end = _store.count;
 }
 
 SK6812::~SK6812()
 {
-	free(_pixels);
+	free(_store.pixels);
 }
 
 void SK6812::set_output(uint8_t pin)
@@ -19,36 +23,14 @@ void SK6812::set_output(uint8_t pin)
 	_port_reg = portModeRegister(digitalPinToPort(pin));
 }
 
-RGBW SK6812::get_rgbw(uint16_t index)
-{
-	RGBW px_value;
-
-	if (index < _count_led) {
-		px_value.r = _pixels[index].r;
-		px_value.g = _pixels[index].g;
-		px_value.b = _pixels[index].b;
-		px_value.w = _pixels[index].w;
-	}
-
-	return px_value;
-}
-
-uint8_t SK6812::set_rgbw(uint16_t index, RGBW px_value)
+// Sends the pixels up to the last one changed, the ones behind keep what they latched before
+void SK6812::sync()
 {
-	if (index < _count_led) {
-		_pixels[index].r = px_value.r;
-		_pixels[index].g = px_value.g;
-		_pixels[index].b = px_value.b;
-		_pixels[index].w = px_value.w;
-
-		return 0;
+	if (!sync_pending()) {
+		return;
 	}
 
-	return 1;
-}
-
-void SK6812::sync()
-{
 	*_port_reg |= _pin_mask;
-	sendarray_mask((uint8_t *)_pixels, _count_led * sizeof(RGBW), _pin_mask, (uint8_t *)_port, (uint8_t *)_port_reg);
-}
\ No newline at end of file
+	sendarray_mask((uint8_t *)_store.pixels, _dirty_end * sizeof(RGBW), _pin_mask, (uint8_t *)_port, (uint8_t *)_port_reg);
+	sync_done();
+}
@@ -16,22 +16,138 @@ struct RGBW {
 	uint8_t w; // 3
 };
 
-class SK6812 {
+/*
+  Pixels, dirty tracking and sync counters shared by the drivers, which
+  only add set_output() and sync() for their transport. store_t holds the
+  pixels: SK6812Heap for a chain sized at run time, SK6812Array for one
+  fixed at build time. A driver's sync() calls sync_pending() first and
+  sends nothing if it returns 0, then sends the first _dirty_end pixels
+  and calls sync_done().
+*/
+
+// Byte counter of a frame, 8 bits while a frame has at most 255 bytes
+template <bool wide> struct sk6812_counter { typedef uint8_t type; };
+template <> struct sk6812_counter<true> { typedef uint16_t type; };
+
+// Pixels on the heap, allocated by the driver
+struct SK6812Heap {
+	typedef uint16_t count_t;
+
+	RGBW *pixels;
+	uint16_t count;
+
+	SK6812Heap() : pixels(0), count(0) {}
+
+	uint16_t size() const
+	{
+		return count;
+	}
+};
+
+// Pixels in a member array, the counters as narrow as the chain allows
+template <uint16_t num_led>
+struct SK6812Array {
+	static_assert(num_led > 0, "SK6812 chain needs a pixel");
+
+	typedef typename sk6812_counter<(num_led * sizeof(RGBW) > 0xFF)>::type count_t;
+
+	RGBW pixels[num_led];
+
+	SK6812Array() : pixels() {}
+
+	static constexpr uint16_t size()
+	{
+		return num_led;
+	}
+};
+
+template <class store_t>
+class SK6812Chain {
+public:
+	typedef typename store_t::count_t count_t;
+
+	// The LEDs are in an unknown state, the first sync sends all of them
+	SK6812Chain() : _store(), _dirty_end(_store.size()), _syncs_sent(0), _syncs_elided(0) {}
+
+	RGBW get_rgbw(uint16_t index)
+	{
+		RGBW px_value = {0, 0, 0, 0};
+
+		if (index < _store.size()) {
+			px_value = _store.pixels[index];
+		}
+
+		return px_value;
+	}
+
+	uint8_t set_rgbw(uint16_t index, RGBW px_value)
+	{
+		if (index < _store.size()) {
+			RGBW &pixel = _store.pixels[index];
+
+			if (pixel.r == px_value.r && pixel.g == px_value.g && pixel.b == px_value.b && pixel.w == px_value.w) {
+				return 0;
+			}
+			if (index >= _dirty_end) {
+				_dirty_end = index + 1;
+			}
+
+			pixel = px_value;
+
+			return 0;
+		}
+
+		return 1;
+	}
+
+	uint32_t get_syncs_sent()
+	{
+		return _syncs_sent;
+	}
+
+	uint32_t get_syncs_elided()
+	{
+		return _syncs_elided;
+	}
+
+protected:
+	store_t _store;
+
+	// Pixels up to this one changed since the last sync, only they are sent
+	count_t _dirty_end;
+
+	// Counts a sync without a change and returns 0 for it
+	uint8_t sync_pending()
+	{
+		if (_dirty_end == 0) {
+			_syncs_elided++;
+			return 0;
+		}
+
+		return 1;
+	}
+
+	void sync_done()
+	{
+		_dirty_end = 0;
+		_syncs_sent++;
+	}
+
+private:
+	uint32_t _syncs_sent;
+	uint32_t _syncs_elided;
+};
+
+class SK6812 : public SK6812Chain<SK6812Heap> {
 public: 
 	SK6812(uint16_t num_led);
 	~SK6812();
 	
 	void set_output(uint8_t pin);
-	
-	RGBW get_rgbw(uint16_t index);
-	uint8_t set_rgbw(uint16_t index, RGBW px_value);
 
 	void sync();
 	
 private:
-	uint16_t _count_led;
-	RGBW *_pixels;
-
 	const volatile uint8_t *_port;
 	volatile uint8_t *_port_reg;
 	uint8_t _pin_mask;
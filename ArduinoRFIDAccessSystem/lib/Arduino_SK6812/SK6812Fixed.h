@@ -0,0 +1,71 @@
+#ifndef SK6812FIXED_H_
+#define SK6812FIXED_H_
+
+#include "SK6812.h"
+#include "SK6812_io.h"
+
+/*
+  SK6812 chain whose length and data pin are fixed at build time.
+
+  The pixels are a member array instead of a heap block, and port and bit
+  of the pin are resolved by the compiler, so sync() needs no pointers and
+  loops with an 8 bit counter for chains of up to 63 pixels. Pin numbers
+  follow the ATmega328P boards (Uno, Nano): 0-7 PORTD, 8-13 PORTB,
+  14-19 PORTC.
+
+  Otherwise it behaves like SK6812: sync() only sends the pixels up to the
+  last one changed and counts the syncs without a change.
+*/
+
+#if !defined(__AVR_ATmega328P__) && !defined(__AVR_ATmega168__)
+#error "SK6812Fixed maps pins of the ATmega328P boards only, use SK6812"
+#endif
+
+template <uint16_t num_led, uint8_t pin>
+class SK6812Fixed : public SK6812Chain<SK6812Array<num_led> > {
+public:
+	static_assert(pin < 20, "SK6812Fixed pin is not on PORTB, PORTC or PORTD");
+
+	typedef typename SK6812Chain<SK6812Array<num_led> >::count_t count_t;
+
+	void set_output()
+	{
+		_SFR_IO8(ddr_io()) |= pin_mask();
+	}
+
+	// Sends the pixels up to the last one changed, the ones behind keep what they latched before
+	void sync()
+	{
+		if (!this->sync_pending()) {
+			return;
+		}
+
+		volatile uint8_t *port = &_SFR_IO8(port_io());
+		uint8_t *data = (uint8_t *)this->_store.pixels;
+		count_t datlen = this->_dirty_end * sizeof(RGBW);
+
+		_SFR_IO8(ddr_io()) |= pin_mask();
+		sk6812_send(data, datlen, port, pin_mask());
+
+		this->sync_done();
+	}
+
+private:
+	// I/O addresses of PORTx and DDRx (PORTx - 1) and bit of the pin
+	static constexpr uint8_t port_io()
+	{
+		return pin < 8 ? 0x0B : pin < 14 ? 0x05 : 0x08;
+	}
+
+	static constexpr uint8_t ddr_io()
+	{
+		return port_io() - 1;
+	}
+
+	static constexpr uint8_t pin_mask()
+	{
+		return 1 << (pin < 8 ? pin : pin < 14 ? pin - 8 : pin - 14);
+	}
+};
+
+#endif /* SK6812FIXED_H_ */
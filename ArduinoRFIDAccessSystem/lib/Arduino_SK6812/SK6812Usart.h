@@ -0,0 +1,80 @@
+#ifndef SK6812USART_H_
+#define SK6812USART_H_
+
+#include "SK6812.h"
+#include "SK6812_timing.h"
+
+/*
+  SK6812 chain driven by USART1 in master SPI mode, for long chains on the
+  ATmega2560/1280 boards (Mega): data on TXD1, pin 18. USART0 carries the
+  serial line of the sketch and stays untouched.
+
+  The USART shifts at F_CPU / 4, 250 ns per symbol at 16 MHz, so a data
+  bit is 5 symbols and a pixel 20 symbol bytes (see SK6812_timing.h).
+  sync() encodes a pixel with interrupts enabled, then feeds its symbol
+  bytes to the USART with interrupts disabled for about 40 us. Between
+  pixels the transmitter is off and the pin is held low, so interrupts
+  are never disabled for longer than one pixel, however long the chain
+  is. Encoding a pixel takes about 30 us, well below the reset time of
+  the LEDs.
+
+  Same methods as SK6812Fixed: the pixels are a member array, sync() only
+  sends the pixels up to the last one changed and counts the syncs
+  without a change.
+*/
+
+#if !defined(__AVR_ATmega2560__) && !defined(__AVR_ATmega1280__)
+#error "SK6812Usart drives USART1 of the ATmega2560/1280 boards only, use SK6812Fixed"
+#endif
+
+// USART1 in master SPI mode at F_CPU / 4
+#define SK6812_USART_UBRR 1
+#define SK6812_USART_SYMBOL_NS (2000000000UL / (F_CPU / (SK6812_USART_UBRR + 1)))
+
+template <uint16_t num_led>
+class SK6812Usart : public SK6812Chain<SK6812Array<num_led> > {
+public:
+	typedef SK6812Encoder<SK6812_USART_SYMBOL_NS> encoder_t;
+
+	// TXD1 (PD3) low while the transmitter is off, XCK1 (PD5) output makes the USART the master
+	void set_output()
+	{
+		PORTD &= ~_BV(PD3);
+		DDRD |= _BV(PD3) | _BV(PD5);
+
+		UBRR1 = 0;
+		UCSR1C = _BV(UMSEL11) | _BV(UMSEL10);
+		UCSR1B = 0;
+		UBRR1 = SK6812_USART_UBRR;
+	}
+
+	// Sends the pixels up to the last one changed, the ones behind keep what they latched before
+	void sync()
+	{
+		if (!this->sync_pending()) {
+			return;
+		}
+
+		uint8_t symbols[encoder_t::size(sizeof(RGBW))];
+
+		for (uint16_t index = 0; index < this->_dirty_end; index++) {
+			uint8_t length = encoder_t::encode((const uint8_t *)&this->_store.pixels[index], sizeof(RGBW), symbols);
+			uint8_t sreg_prev = SREG;
+
+			cli();
+			UCSR1A = _BV(TXC1);
+			UCSR1B = _BV(TXEN1);
+			for (uint8_t i = 0; i < length; i++) {
+				while (!(UCSR1A & _BV(UDRE1)));
+				UDR1 = symbols[i];
+			}
+			while (!(UCSR1A & _BV(TXC1)));
+			UCSR1B = 0;
+			SREG = sreg_prev;
+		}
+
+		this->sync_done();
+	}
+};
+
+#endif /* SK6812USART_H_ */
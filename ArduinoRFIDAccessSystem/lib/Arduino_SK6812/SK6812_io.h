@@ -0,0 +1,41 @@
+#ifndef SK6812_IO_H_
+#define SK6812_IO_H_
+
+#include "SK6812.h"
+#include "SK6812_byte.h"
+
+/*
+  These routines write bytes with RGB values to the Dataout pin using the
+  fast 800kHz clockless WS2811/2812 protocol. They are shared by SK6812
+  and SK6812Fixed.
+
+  Interrupts are disabled for one pixel at a time, about 40 us, however
+  long the chain is. Between pixels the line stays low while pending
+  interrupts run; a pause shorter than the reset time of the LEDs (80 us
+  for the SK6812) does not end the frame. The other bits of the port are
+  read again with interrupts disabled before every pixel, so a handler
+  that changes them in such a pause (tone() on a pin of the same port)
+  is not undone by the rest of the frame.
+*/
+
+// Sends length bytes a pixel at a time, restoring the interrupt flag after each pixel, port is the output register of the pin
+template <typename count_t>
+__attribute__((always_inline)) inline void sk6812_send(uint8_t *data, count_t length, volatile uint8_t *port, uint8_t pinmask)
+{
+  uint8_t sreg_prev = SREG;
+
+  while (length) {
+    uint8_t pixel = length < sizeof(RGBW) ? length : sizeof(RGBW);
+    length -= pixel;
+
+    cli();
+    uint8_t masklo = ~pinmask & *port;
+    uint8_t maskhi = pinmask | *port;
+    while (pixel--) {
+      sk6812_send_byte(*data++, port, maskhi, masklo);
+    }
+    SREG = sreg_prev;
+  }
+}
+
+#endif /* SK6812_IO_H_ */
@@ -0,0 +1,88 @@
+#ifndef SK6812_TIMING_H_
+#define SK6812_TIMING_H_
+
+#include <stdint.h>
+
+/*
+  Bit timing of the SK6812 protocol, and its encoding into symbols for
+  drivers that shift the bits out of a serial peripheral instead of
+  toggling the pin. Free of AVR headers, so the encoding can be checked
+  on a host.
+
+  A data bit takes w_totalperiod: w_zeropulse or w_onepulse high, then
+  low. At a symbol time of symbol_ns each part is rounded to the nearest
+  whole number of symbols, so a bit ends low and a pause between symbol
+  bytes only stretches a low phase.
+*/
+
+// Timing in ns
+#define w_zeropulse   350
+#define w_onepulse    900
+#define w_totalperiod 1250
+
+// Deviation of a rounded time the LEDs still accept
+#define w_tolerance   150
+
+// Symbols of a time, rounded to the nearest
+constexpr uint8_t sk6812_symbols(uint16_t ns, uint16_t symbol_ns)
+{
+  return (ns + symbol_ns / 2) / symbol_ns;
+}
+
+// Checks that a time rounded to symbols stays within the tolerance
+constexpr bool sk6812_symbols_fit(uint16_t ns, uint16_t symbol_ns)
+{
+  return sk6812_symbols(ns, symbol_ns) * symbol_ns + w_tolerance >= ns &&
+    sk6812_symbols(ns, symbol_ns) * symbol_ns <= ns + w_tolerance;
+}
+
+template <uint16_t symbol_ns>
+struct SK6812Encoder {
+  enum {
+    zero = sk6812_symbols(w_zeropulse, symbol_ns),
+    one = sk6812_symbols(w_onepulse, symbol_ns),
+    period = sk6812_symbols(w_totalperiod, symbol_ns)
+  };
+
+  static_assert(sk6812_symbols_fit(w_zeropulse, symbol_ns) && sk6812_symbols_fit(w_onepulse, symbol_ns) &&
+    sk6812_symbols_fit(w_totalperiod, symbol_ns) && zero > 0 && period > one, "Symbol time too long for the SK6812 timing");
+  static_assert(period <= 8, "Symbol time too short, a bit has to fit into a symbol byte");
+
+  // Symbol bytes needed for length data bytes
+  static constexpr uint16_t size(uint16_t length)
+  {
+    return ((uint32_t)length * 8 * period + 7) / 8;
+  }
+
+  // Encodes length data bytes MSB first into symbol bytes MSB first, the last one padded low; returns the bytes written
+  static uint16_t encode(const uint8_t *data, uint16_t length, uint8_t *symbols)
+  {
+    uint16_t written = 0;
+    uint16_t pending = 0;   // Symbols not yet written, in the low bits
+    uint8_t count = 0;
+
+    while (length--) {
+      uint8_t value = *data++;
+
+      for (uint8_t bit = 0; bit < 8; bit++) {
+        uint8_t high = (value & 0x80) ? one : zero;
+
+        pending = pending << period | (((1 << high) - 1) << (period - high));
+        count += period;
+        value <<= 1;
+
+        if (count >= 8) {
+          count -= 8;
+          symbols[written++] = pending >> count;
+        }
+      }
+    }
+
+    if (count) {
+      symbols[written++] = pending << (8 - count);
+    }
+    return written;
+  }
+};
+
+#endif /* SK6812_TIMING_H_ */
@@ -0,0 +1,25 @@
+//==================== Includes ====================
+
+#include "crc8.h"
+
+
+//==================== CRC Functions ====================
+
+//Adds one byte to a running CRC
+unsigned char crc8Update(unsigned char crc, unsigned char data)
+{
+  crc ^= data;
+  for (unsigned char bit = 0; bit < 8; bit++)
+    crc = (crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1;
+  return crc;
+}
+
+//CRC over a whole buffer
+unsigned char crc8(const unsigned char *data, unsigned char length)
+{
+  unsigned char crc = 0;
+
+  while (length--)
+    crc = crc8Update(crc, *data++);
+  return crc;
+}
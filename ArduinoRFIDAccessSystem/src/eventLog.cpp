@@ -0,0 +1,94 @@
+//==================== Includes ====================
+
+#include "eventLog.h"
+#include "frame.h"
+#include "hal.h"
+
+#if 3 + EVENTLOG_RECORD_MAX > FRAME_PAYLOAD_MAX
+#error "Event log record does not fit into one frame"
+#endif
+
+//==================== Objects ====================
+
+typedef struct
+{
+  unsigned long time;
+  tagUID_t UID;
+  unsigned char info;
+  unsigned char latency;
+  unsigned char reader;
+} eventRecord_t;
+
+//==================== Global Variables ====================
+
+eventRecord_t eventRing[EVENTLOG_ENTRIES];
+unsigned char eventNext = 0;        // Slot of the next record
+unsigned char eventCount = 0;       // Records waiting to be sent
+unsigned char eventDropped = 0;     // Records overwritten since the last frame, saturating
+uint16_t eventSequence = 0;
+
+
+//==================== Event Log Functions ====================
+
+//Appends an event, the oldest waiting record is overwritten if the ring is full
+void eventLog(unsigned char event, unsigned char reader, const tagUID_t *UID, unsigned long latency)
+{
+  eventRecord_t *record = &eventRing[eventNext];
+
+  record->time = halMillis();
+  record->UID = *UID;
+  record->info = (event & 0x0F) | (UID->size << 4);
+  record->latency = latency > 0xFF ? 0xFF : latency;
+  record->reader = reader;
+  eventNext = (eventNext + 1) % EVENTLOG_ENTRIES;
+
+  if(eventCount < EVENTLOG_ENTRIES) eventCount++;
+  else if(eventDropped < 0xFF) eventDropped++;
+}
+
+//Sends a batch once enough records waited or the oldest is old enough, called once per loop tick
+void eventLogUpdate()
+{
+  if(eventCount == 0) return;
+
+  unsigned char slot = (eventNext + EVENTLOG_ENTRIES - eventCount) % EVENTLOG_ENTRIES;
+  if(eventCount < EVENTLOG_BATCH && halMillis() - eventRing[slot].time < EVENTLOG_FLUSH_AGE) return;
+
+  unsigned char *payload = frameStart(FRAME_EVENTS);
+  if(payload == 0) return;
+
+  unsigned char count = 0;
+  unsigned char length = 0;
+
+  payload[length++] = eventSequence & 0xFF;
+  payload[length++] = eventSequence >> 8;
+  payload[length++] = eventDropped;
+
+  // Records are as long as their UID, the frame takes as many as fit
+  while(count < eventCount && count < EVENTLOG_FRAME_RECORDS)
+  {
+    eventRecord_t *record = &eventRing[slot];
+    unsigned char size = record->UID.size != 0 ? record->UID.size : 4;
+    if(length + EVENTLOG_RECORD_HEADER + size > FRAME_PAYLOAD_MAX) break;
+
+    for (unsigned char b = 0; b < 4; b++)
+      payload[length++] = record->time >> (8 * b);
+    payload[length++] = record->info;
+    payload[length++] = record->latency;
+    payload[length++] = record->reader;
+    if(record->UID.size != 0) length += uidBytes(&record->UID, &payload[length]);
+    else
+    {
+      for (unsigned char b = 0; b < 4; b++)
+        payload[length++] = record->UID.head >> (8 * b);
+    }
+
+    count++;
+    slot = (slot + 1) % EVENTLOG_ENTRIES;
+  }
+
+  frameFinish(length);
+  eventCount -= count;
+  eventDropped = 0;
+  eventSequence++;
+}
@@ -0,0 +1,229 @@
+//==================== Includes ====================
+
+#include <string.h>
+#include "framTable.h"
+
+#if FRAM_HEADER_SIZE + FRAM_PAGE_ENTRIES * FRAM_ENTRY_SIZE > FRAM_PAGE_SIZE
+#error "FRAM page entries do not fit into a page"
+#endif
+
+//==================== Defines ====================
+
+/*Header bytes*/
+#define FRAM_USED 0
+#define FRAM_OVERFLOW 1
+#define FRAM_MARK 2
+
+//==================== Objects ====================
+
+/*struct for a page kept in RAM*/
+typedef struct
+{
+  unsigned int page;
+  bool valid;
+  unsigned char data[FRAM_PAGE_SIZE];
+} framCache_t;
+
+//==================== Function Prototypes ====================
+
+unsigned int framHome(const tagUID_t *UID);
+unsigned long framAddress(unsigned int page);
+unsigned char *framPage(unsigned int page);
+void framWrite(unsigned int page, unsigned char offset, const void *data, unsigned char length);
+void framEntry(const tagUID_t *UID, unsigned char *entry);
+bool framLocate(const tagUID_t *UID, unsigned int *page, unsigned char *index);
+
+//==================== Global Variables ====================
+
+framCache_t framCache[FRAM_CACHE_PAGES] = {0};
+unsigned char framCacheNext = 0;  // Cache line replaced next
+unsigned int framCount = 0;       // UIDs in the table
+
+
+//==================== FRAM Table Functions ====================
+
+//Checks if the chip holds a table and counts its UIDs, returns 0 if it is not formatted
+bool framTableBegin()
+{
+  framCount = 0;
+
+  for (unsigned int page = 0; page < FRAM_PAGES; page++)
+  {
+    unsigned char header[FRAM_HEADER_SIZE];
+    halFramRead(framAddress(page), header, sizeof(header));
+
+    uint16_t mark = header[FRAM_MARK] | header[FRAM_MARK + 1] << 8;
+    if(mark != (FRAM_PAGE_MARK ^ page)) return 0;
+
+    for (unsigned char index = 0; index < FRAM_PAGE_ENTRIES; index++)
+      if((header[FRAM_USED] >> index) & 1) framCount++;
+  }
+  return 1;
+}
+
+//Empties the table, the last page stays unmarked until framTableCommit so a cut-off format or fill is noticed
+void framTableFormat()
+{
+  unsigned char header[FRAM_HEADER_SIZE] = {0};
+
+  framWrite(FRAM_PAGES - 1, 0, header, sizeof(header));
+
+  for (unsigned int page = 0; page < FRAM_PAGES - 1; page++)
+  {
+    uint16_t mark = FRAM_PAGE_MARK ^ page;
+    header[FRAM_MARK] = mark & 0xFF;
+    header[FRAM_MARK + 1] = mark >> 8;
+    framWrite(page, 0, header, sizeof(header));
+  }
+  framCount = 0;
+}
+
+//Marks the last page after a format and what was filled in since, framTableBegin takes the table from now on
+void framTableCommit()
+{
+  uint16_t mark = FRAM_PAGE_MARK ^ (FRAM_PAGES - 1);
+  unsigned char bytes[2] = {(unsigned char)(mark & 0xFF), (unsigned char)(mark >> 8)};
+
+  framWrite(FRAM_PAGES - 1, FRAM_MARK, bytes, sizeof(bytes));
+}
+
+//Checks if UID is in the table
+bool framTableFind(const tagUID_t *UID)
+{
+  unsigned int page;
+  unsigned char index;
+
+  return framLocate(UID, &page, &index);
+}
+
+//Adds UID to the first page from its home on with room, returns 0 if the table is full
+bool framTableInsert(const tagUID_t *UID)
+{
+  unsigned char entry[FRAM_ENTRY_SIZE];
+  unsigned int page = framHome(UID);
+
+  if(UID->size == 0 || framTableCount() >= FRAM_TABLE_ENTRIES) return 0;
+  framEntry(UID, entry);
+
+  for (unsigned int probe = 0; probe < FRAM_PAGES; probe++)
+  {
+    unsigned char *data = framPage(page);
+    unsigned char used = data[FRAM_USED];
+
+    for (unsigned char index = 0; index < FRAM_PAGE_ENTRIES; index++)
+    {
+      if((used >> index) & 1) continue;
+
+      // Entry first, then the used bit commits it
+      used |= 1 << index;
+      framWrite(page, FRAM_HEADER_SIZE + index * FRAM_ENTRY_SIZE, entry, FRAM_ENTRY_SIZE);
+      framWrite(page, FRAM_USED, &used, 1);
+      framCount++;
+      return 1;
+    }
+
+    // Full, lookups have to continue past this page from now on
+    if(!data[FRAM_OVERFLOW])
+    {
+      unsigned char overflow = 1;
+      framWrite(page, FRAM_OVERFLOW, &overflow, 1);
+    }
+    page = (page + 1) & (FRAM_PAGES - 1);
+  }
+  return 0;
+}
+
+//Takes UID out of the table, returns 0 if it was not in; overflow marks stay until the next format
+bool framTableDelete(const tagUID_t *UID)
+{
+  unsigned int page;
+  unsigned char index;
+
+  if(!framLocate(UID, &page, &index)) return 0;
+
+  unsigned char used = framPage(page)[FRAM_USED] & ~(1 << index);
+  framWrite(page, FRAM_USED, &used, 1);
+  framCount--;
+  return 1;
+}
+
+//Returns the number of UIDs in the table
+unsigned int framTableCount()
+{
+  return framCount;
+}
+
+
+//==================== Page Functions ====================
+
+//Returns the page a UID is looked for first (Fibonacci hashing)
+unsigned int framHome(const tagUID_t *UID)
+{
+  return (uint32_t)(uidKey(UID) * 2654435769UL) >> (32 - FRAM_PAGE_BITS);
+}
+
+//Returns the FRAM address of a page
+unsigned long framAddress(unsigned int page)
+{
+  return (unsigned long)page * FRAM_PAGE_SIZE;
+}
+
+//Returns the content of a page, read into the cache if it is not there
+unsigned char *framPage(unsigned int page)
+{
+  for (unsigned char line = 0; line < FRAM_CACHE_PAGES; line++)
+  {
+    if(framCache[line].valid && framCache[line].page == page) return framCache[line].data;
+  }
+
+  framCache_t *line = &framCache[framCacheNext];
+  framCacheNext = (framCacheNext + 1) % FRAM_CACHE_PAGES;
+
+  halFramRead(framAddress(page), line->data, FRAM_PAGE_SIZE);
+  line->page = page;
+  line->valid = 1;
+  return line->data;
+}
+
+//Writes part of a page to the chip and to its cached copy
+void framWrite(unsigned int page, unsigned char offset, const void *data, unsigned char length)
+{
+  halFramWrite(framAddress(page) + offset, data, length);
+
+  for (unsigned char line = 0; line < FRAM_CACHE_PAGES; line++)
+  {
+    if(framCache[line].valid && framCache[line].page == page) memcpy(&framCache[line].data[offset], data, length);
+  }
+}
+
+//Lays out the entry of a UID: size, bytes, zero padding
+void framEntry(const tagUID_t *UID, unsigned char *entry)
+{
+  memset(entry, 0, FRAM_ENTRY_SIZE);
+  entry[0] = uidBytes(UID, &entry[1]);
+}
+
+//Finds the page and entry holding UID, returns 0 if there is none
+bool framLocate(const tagUID_t *UID, unsigned int *page, unsigned char *index)
+{
+  unsigned char entry[FRAM_ENTRY_SIZE];
+
+  if(UID->size == 0) return 0;
+  framEntry(UID, entry);
+  *page = framHome(UID);
+
+  for (unsigned int probe = 0; probe < FRAM_PAGES; probe++)
+  {
+    unsigned char *data = framPage(*page);
+    halCount(HAL_COUNT_PROBE);
+
+    for (*index = 0; *index < FRAM_PAGE_ENTRIES; (*index)++)
+    {
+      if(((data[FRAM_USED] >> *index) & 1) && memcmp(&data[FRAM_HEADER_SIZE + *index * FRAM_ENTRY_SIZE], entry, FRAM_ENTRY_SIZE) == 0) return 1;
+    }
+
+    if(!data[FRAM_OVERFLOW]) return 0;
+    *page = (*page + 1) & (FRAM_PAGES - 1);
+  }
+  return 0;
+}
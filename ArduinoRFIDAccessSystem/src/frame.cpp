@@ -0,0 +1,95 @@
+//==================== Includes ====================
+
+#include "crc8.h"
+#include "frame.h"
+#include "hal.h"
+
+
+//==================== Global Variables ====================
+
+/*Frame being sent, header + payload + CRC*/
+unsigned char frameBuffer[FRAME_HEADER_SIZE + FRAME_PAYLOAD_MAX + 1];
+unsigned char frameLength = 0;  // Bytes in frameBuffer, 0 if idle
+unsigned char frameSent = 0;    // Bytes already handed to the UART
+
+/*Frame being received, header + payload + CRC*/
+unsigned char frameRxBuffer[FRAME_HEADER_SIZE + FRAME_RX_PAYLOAD_MAX + 1];
+unsigned char frameRxLength = 0;  // Bytes received so far, 0 while waiting for the sync byte
+unsigned long frameRxLast = 0;    // ms of the last byte received
+
+
+//==================== Frame Functions ====================
+
+//Returns the payload area of a new frame, 0 while the previous one is still being sent
+unsigned char *frameStart(unsigned char type)
+{
+  if(frameBusy()) return 0;
+
+  frameBuffer[0] = FRAME_SYNC;
+  frameBuffer[1] = type;
+  return &frameBuffer[FRAME_HEADER_SIZE];
+}
+
+//Seals the frame started by frameStart() and queues it for sending
+void frameFinish(unsigned char length)
+{
+  if(length > FRAME_PAYLOAD_MAX) length = FRAME_PAYLOAD_MAX;
+
+  frameBuffer[2] = length;
+  frameBuffer[FRAME_HEADER_SIZE + length] = crc8(&frameBuffer[1], length + FRAME_HEADER_SIZE - 1);
+
+  frameLength = FRAME_HEADER_SIZE + length + 1;
+  frameSent = 0;
+}
+
+//Moves the pending frame on to the UART without waiting
+void frameUpdate()
+{
+  if(!frameBusy()) return;
+
+  frameSent += halSerialWrite(&frameBuffer[frameSent], frameLength - frameSent);
+  if(frameSent >= frameLength) frameLength = 0;
+}
+
+//Returns 1 while a frame is being sent
+bool frameBusy()
+{
+  return frameLength != 0;
+}
+
+//Adds a received byte to the frame being assembled, returns 1 once a complete frame with valid CRC is in
+bool frameReceive(unsigned char data)
+{
+  if(!frameReceiving() && data != FRAME_SYNC) return 0;
+
+  frameRxLast = halMillis();
+  frameRxBuffer[frameRxLength++] = data;
+  if(frameRxLength < FRAME_HEADER_SIZE) return 0;
+
+  unsigned char length = frameRxBuffer[2];
+  if(length > FRAME_RX_PAYLOAD_MAX)
+  {
+    frameRxLength = 0;
+    return 0;
+  }
+  if(frameRxLength < FRAME_HEADER_SIZE + length + 1) return 0;
+
+  // Complete, the next byte starts a new frame whether this one was valid or not
+  frameRxLength = 0;
+  return frameRxBuffer[FRAME_HEADER_SIZE + length] == crc8(&frameRxBuffer[1], length + FRAME_HEADER_SIZE - 1);
+}
+
+//Returns 1 while a frame is being assembled, one silent for FRAME_RX_GAP ms is dropped
+bool frameReceiving()
+{
+  if(frameRxLength != 0 && halMillis() - frameRxLast >= FRAME_RX_GAP) frameRxLength = 0;
+  return frameRxLength != 0;
+}
+
+//Returns the payload of the last frame frameReceive() completed
+const unsigned char *frameReceived(unsigned char *type, unsigned char *length)
+{
+  *type = frameRxBuffer[1];
+  *length = frameRxBuffer[2];
+  return &frameRxBuffer[FRAME_HEADER_SIZE];
+}
@@ -0,0 +1,92 @@
+//==================== Includes ====================
+
+#include <string.h>
+#include "grantCache.h"
+
+#if GRANT_CACHE_ENTRIES > 8
+#error "Reference bits of the grant cache are kept in one byte"
+#endif
+
+//==================== Global Variables ====================
+
+tagUID_t grantCache[GRANT_CACHE_ENTRIES] = {0};   // size 0 marks a free entry
+unsigned char grantCacheReferenced = 0;           // Bit per entry, set by hits
+unsigned char grantCacheHand = 0;                 // Entry the CLOCK hand points at
+unsigned long grantCacheHits = 0;
+unsigned long grantCacheMisses = 0;
+
+
+//==================== Grant Cache Functions ====================
+
+//Checks if UID was granted recently, a hit gives its entry another round
+bool grantCacheFind(const tagUID_t *UID)
+{
+  for (unsigned char entry = 0; entry < GRANT_CACHE_ENTRIES; entry++)
+  {
+    if(grantCache[entry].size == 0 || !uidEqual(&grantCache[entry], UID)) continue;
+
+    grantCacheReferenced |= 1 << entry;
+    grantCacheHits++;
+    return 1;
+  }
+
+  grantCacheMisses++;
+  return 0;
+}
+
+//Keeps a granted UID in a free entry, or in the first one the hand finds unreferenced
+void grantCacheAdd(const tagUID_t *UID)
+{
+  unsigned char entry = 0;
+
+  if(UID->size == 0) return;
+  while(entry < GRANT_CACHE_ENTRIES && grantCache[entry].size != 0) entry++;
+
+  if(entry == GRANT_CACHE_ENTRIES)
+  {
+    while((grantCacheReferenced >> grantCacheHand) & 1)
+    {
+      grantCacheReferenced &= ~(1 << grantCacheHand);
+      grantCacheHand = (grantCacheHand + 1) % GRANT_CACHE_ENTRIES;
+    }
+    entry = grantCacheHand;
+    grantCacheHand = (grantCacheHand + 1) % GRANT_CACHE_ENTRIES;
+  }
+
+  grantCache[entry] = *UID;
+}
+
+//Forgets UID, called when it leaves the Whitelist
+void grantCacheRemove(const tagUID_t *UID)
+{
+  for (unsigned char entry = 0; entry < GRANT_CACHE_ENTRIES; entry++)
+  {
+    if(grantCache[entry].size == 0 || !uidEqual(&grantCache[entry], UID)) continue;
+
+    uidClear(&grantCache[entry]);
+    grantCacheReferenced &= ~(1 << entry);
+  }
+}
+
+//Forgets all UIDs, called when the Whitelist or the Master is reset
+void grantCacheClear()
+{
+  memset(grantCache, 0, sizeof(grantCache));
+  grantCacheReferenced = 0;
+}
+
+//Returns the hits and misses since power-up
+void grantCacheStats(unsigned long *hits, unsigned long *misses)
+{
+  *hits = grantCacheHits;
+  *misses = grantCacheMisses;
+}
+
+//Copies the UID an entry holds, returns 0 if the entry is free
+bool grantCacheEntry(unsigned char entry, tagUID_t *UID)
+{
+  if(entry >= GRANT_CACHE_ENTRIES || grantCache[entry].size == 0) return 0;
+
+  *UID = grantCache[entry];
+  return 1;
+}
@@ -0,0 +1,356 @@
+#ifdef ARDUINO
+
+//==================== Includes ====================
+
+#include <Arduino.h>
+#include <avr/sleep.h>
+#include <EEPROM.h>
+#include <SPI.h>
+#include <MFRC522.h>
+#include "hal.h"
+#ifdef HAL_LED_USART
+#include "../lib/Arduino_SK6812/SK6812Usart.h"
+#else
+#include "../lib/Arduino_SK6812/SK6812Fixed.h"
+#endif
+
+
+//==================== Defines ====================
+
+/*Pin definition, the readers share RST_PIN and the SPI bus*/
+#define RST_PIN 9
+#define SS_PIN 10
+#define FRAM_CS_PIN 8
+
+/*Chip selects of the readers, see HAL_READERS*/
+#define READER_SS_PINS {SS_PIN, 7, 6, 5}
+#define READER_SS_PINS_COUNT 4
+
+#if HAL_READERS > READER_SS_PINS_COUNT
+#error "More readers than chip selects"
+#endif
+
+/*FRAM opcodes, 24 bit addresses*/
+#define FRAM_WREN 0x06
+#define FRAM_READ 0x03
+#define FRAM_WRITE 0x02
+#define FRAM_SPI_CLOCK 8000000
+
+/*MFRC522 receive timeouts in 25 us timer steps*/
+#define READER_TIMEOUT_POLL 40          // 1 ms, enough for ATQA
+#define READER_TIMEOUT_TRANSACTION 1000 // 25 ms, library default
+
+/*Written over the free SRAM by halRamMark(), bytes below the stack pointer left to its own frame*/
+#define RAM_MARK 0xA5
+#define RAM_MARK_GUARD 16
+
+/*Pixels in the LED chain*/
+#define LED_COUNT HAL_READERS
+
+#define SERIAL_BAUD 115200
+
+//==================== Function Prototypes ====================
+
+void readerTimeout(unsigned char reader, unsigned int steps);
+void framSelect(unsigned char opcode, unsigned long address);
+void framDeselect();
+
+//==================== Global Variables ====================
+
+#ifdef HAL_LED_USART
+SK6812Usart<LED_COUNT> LED;               // LED chain on TXD1, sized at build time
+#else
+SK6812Fixed<LED_COUNT, HAL_LED_PIN> LED;  // LED chain, sized at build time
+#endif
+MFRC522 mfrc522[HAL_READERS];     // MFRC522 instances, pins set by halReaderBegin()
+const unsigned char readerSsPins[READER_SS_PINS_COUNT] = READER_SS_PINS;
+MFRC522::MIFARE_Key key;
+
+/*Set by Timer1 once per tick*/
+volatile bool tickPending = 0;
+
+/*Heap bounds of avr-libc*/
+extern char __heap_start;
+extern char *__brkval;
+
+
+//==================== Memory ====================
+
+//Fills the SRAM between heap and stack with RAM_MARK
+void halRamMark()
+{
+  char top;
+
+  for (char *cell = __brkval == 0 ? &__heap_start : __brkval; cell < &top - RAM_MARK_GUARD; cell++) *cell = RAM_MARK;
+}
+
+//Distance from the top of the heap to the deepest the stack went since halRamMark()
+unsigned int halFreeRam()
+{
+  char top;
+  char *heap = __brkval == 0 ? &__heap_start : __brkval;
+  char *cell = heap;
+
+  while(cell < &top && *cell == (char)RAM_MARK) cell++;
+  return cell - heap;
+}
+
+
+//==================== Clock ====================
+
+unsigned long halMillis()
+{
+  return millis();
+}
+
+unsigned long halMicros()
+{
+  return micros();
+}
+
+//Starts Timer1 in CTC mode, raising tickPending every period ms
+void halTickBegin(unsigned int period)
+{
+  noInterrupts();
+  TCCR1A = 0;
+  TCCR1B = (1 << WGM12) | (1 << CS11) | (1 << CS10); // CTC, prescaler 64
+  TCNT1 = 0;
+  OCR1A = F_CPU / 64 / 1000 * period - 1;
+  TIMSK1 = (1 << OCIE1A);
+  interrupts();
+}
+
+ISR(TIMER1_COMPA_vect)
+{
+  tickPending = 1;
+}
+
+//Sleeps until the next tick, millis(), tone() and serial keep running in idle sleep
+void halTickWait()
+{
+  set_sleep_mode(SLEEP_MODE_IDLE);
+
+  noInterrupts();
+  while(!tickPending)
+  {
+    // sleep_cpu() runs before any interrupt enabled here, so no tick is missed
+    sleep_enable();
+    interrupts();
+    sleep_cpu();
+    sleep_disable();
+    noInterrupts();
+  }
+  tickPending = 0;
+  interrupts();
+}
+
+
+//==================== GPIO and Buzzer ====================
+
+void halPinOutput(unsigned char pin)
+{
+  pinMode(pin, OUTPUT);
+}
+
+void halPinWrite(unsigned char pin, bool high)
+{
+  digitalWrite(pin, high ? HIGH : LOW);
+}
+
+void halTone(unsigned char pin, unsigned int frequency)
+{
+  tone(pin, frequency);
+}
+
+void halNoTone(unsigned char pin)
+{
+  noTone(pin);
+}
+
+
+//==================== Signal LED ====================
+
+void halLedBegin()
+{
+  LED.set_output();
+}
+
+//Sends the chain only if the color changed, the library counts the syncs it left out
+void halLedShow(unsigned char pixel, RGBW color)
+{
+  LED.set_rgbw(pixel, color);
+  LED.sync();
+}
+
+void halLedStats(unsigned long *sent, unsigned long *elided)
+{
+  *sent = LED.get_syncs_sent();
+  *elided = LED.get_syncs_elided();
+}
+
+
+//==================== Serial Line ====================
+
+void halSerialBegin()
+{
+  Serial.begin(SERIAL_BAUD);
+}
+
+//Returns the next received byte, -1 if there is none
+int halSerialRead()
+{
+  return Serial.read();
+}
+
+//Queues as many bytes as the interrupt-driven transmit buffer takes, returns their number
+unsigned int halSerialWrite(const unsigned char *data, unsigned int length)
+{
+  unsigned int room = Serial.availableForWrite();
+  if(length > room) length = room;
+
+  return Serial.write(data, length);
+}
+
+
+//==================== EEPROM ====================
+
+void halEepromRead(unsigned int address, void *data, unsigned int length)
+{
+  for (unsigned int i = 0; i < length; i++)
+    ((unsigned char *)data)[i] = EEPROM.read(address + i);
+}
+
+void halEepromWrite(unsigned int address, const void *data, unsigned int length)
+{
+  for (unsigned int i = 0; i < length; i++)
+    EEPROM.update(address + i, ((const unsigned char *)data)[i]);
+}
+
+
+//==================== RFID Reader ====================
+
+//Starts the bus and all readers, all chip selects are raised before the first one talks
+void halReaderBegin()
+{
+  SPI.begin();        // Initiate  SPI bus
+
+  for (unsigned char reader = 0; reader < HAL_READERS; reader++)
+  {
+    pinMode(readerSsPins[reader], OUTPUT);
+    digitalWrite(readerSsPins[reader], HIGH);
+  }
+  for (unsigned char reader = 0; reader < HAL_READERS; reader++)
+    mfrc522[reader].PCD_Init(readerSsPins[reader], RST_PIN); // Initiate MFRC522
+
+  for (byte i = 0; i < 6; i++)
+    key.keyByte[i] = 0xFF;
+}
+
+//Sends one WUPA, returns 1 if a Tag answered; WUPA also wakes halted Tags
+bool halReaderWakeup(unsigned char reader)
+{
+  byte atqa[2];
+  byte atqaSize = sizeof(atqa);
+
+  readerTimeout(reader, READER_TIMEOUT_POLL);
+  MFRC522::StatusCode status = mfrc522[reader].PICC_WakeupA(atqa, &atqaSize);
+
+  return status == MFRC522::STATUS_OK || status == MFRC522::STATUS_COLLISION;
+}
+
+//Sends the woken Tag back to sleep until the next wake-up
+void halReaderHalt(unsigned char reader)
+{
+  mfrc522[reader].PICC_HaltA();
+}
+
+//Selects the woken Tag and leaves it active, returns 0 if selection failed
+bool halReaderSelect(unsigned char reader, tagUID_t *UID)
+{
+  readerTimeout(reader, READER_TIMEOUT_TRANSACTION);
+  if (!mfrc522[reader].PICC_ReadCardSerial()) return 0;
+
+  // UID from the anticollision loop, 4, 7 or 10 bytes
+  uidSet(UID, mfrc522[reader].uid.uidByte, mfrc522[reader].uid.size);
+  return 1;
+}
+
+//Reads a 16 byte block of the selected Tag with the default key
+bool halReaderReadBlock(unsigned char reader, unsigned char block, unsigned char *data)
+{
+  byte buffer[18];
+  byte bufferLen = sizeof(buffer);
+
+  if (mfrc522[reader].PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, block, &key, &(mfrc522[reader].uid)) != MFRC522::STATUS_OK) return 0;
+  if (mfrc522[reader].MIFARE_Read(block, buffer, &bufferLen) != MFRC522::STATUS_OK) return 0;
+
+  memcpy(data, buffer, 16);
+  return 1;
+}
+
+//Halts the selected Tag so the next wake-up finds it, leaves the reader unencrypted
+void halReaderRelease(unsigned char reader)
+{
+  readerTimeout(reader, READER_TIMEOUT_POLL);
+  mfrc522[reader].PICC_HaltA();
+  mfrc522[reader].PCD_StopCrypto1();
+}
+
+//Sets how long the MFRC522 waits for a Tag to answer
+void readerTimeout(unsigned char reader, unsigned int steps)
+{
+  mfrc522[reader].PCD_WriteRegister(MFRC522::TReloadRegH, steps >> 8);
+  mfrc522[reader].PCD_WriteRegister(MFRC522::TReloadRegL, steps & 0xFF);
+}
+
+
+//==================== External FRAM ====================
+
+//Sets up the chip select, the bus is started by halReaderBegin()
+void halFramBegin()
+{
+  pinMode(FRAM_CS_PIN, OUTPUT);
+  digitalWrite(FRAM_CS_PIN, HIGH);
+}
+
+void halFramRead(unsigned long address, void *data, unsigned int length)
+{
+  framSelect(FRAM_READ, address);
+  for (unsigned int i = 0; i < length; i++)
+    ((unsigned char *)data)[i] = SPI.transfer(0);
+  framDeselect();
+}
+
+//FRAM writes take effect at once, no page boundaries or write cycles to wait for
+void halFramWrite(unsigned long address, const void *data, unsigned int length)
+{
+  SPI.beginTransaction(SPISettings(FRAM_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+  digitalWrite(FRAM_CS_PIN, LOW);
+  SPI.transfer(FRAM_WREN);
+  digitalWrite(FRAM_CS_PIN, HIGH);
+  SPI.endTransaction();
+
+  framSelect(FRAM_WRITE, address);
+  for (unsigned int i = 0; i < length; i++)
+    SPI.transfer(((const unsigned char *)data)[i]);
+  framDeselect();
+}
+
+//Starts a FRAM transaction, the MFRC522 keeps its own SPI settings between them
+void framSelect(unsigned char opcode, unsigned long address)
+{
+  SPI.beginTransaction(SPISettings(FRAM_SPI_CLOCK, MSBFIRST, SPI_MODE0));
+  digitalWrite(FRAM_CS_PIN, LOW);
+  SPI.transfer(opcode);
+  SPI.transfer(address >> 16);
+  SPI.transfer(address >> 8);
+  SPI.transfer(address);
+}
+
+void framDeselect()
+{
+  digitalWrite(FRAM_CS_PIN, HIGH);
+  SPI.endTransaction();
+}
+
+#endif /* ARDUINO */
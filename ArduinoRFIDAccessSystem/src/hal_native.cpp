@@ -0,0 +1,1572 @@
+#ifndef ARDUINO
+
+//==================== Includes ====================
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "hal.h"
+#include "crc8.h"
+#include "frame.h"
+#include "ledAnim.h"
+#include "provision.h"
+#include "store.h"
+#include "telemetry.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SIM_CYCLES() __rdtsc()
+#endif
+
+/*
+  Host simulation of the access system hardware.
+
+  The badge trace is read from stdin, one event per line, times in ms
+  since power-up:
+
+    <ms> tag <UID hex> [master]   Tag enters the field (4, 7 or 10 bytes)
+    <ms> none                     Field is empty
+    <ms> tag:<n> ..., none:<n>    The same for reader n, see HAL_READERS
+    <ms> serial <hex>             Bytes arriving on the serial line
+    <ms> wait <type>              Hold the rest of the trace until a frame of
+                                  this type is sent, events due meanwhile follow
+                                  right after it (host waiting for a reply)
+    <ms> mark                     Restart the benchmark statistics
+    <ms> end                      Stop the simulation
+    # comment
+
+  Outputs are written to stdout as they change, one line each:
+
+    <ms> pin <pin> high|low
+    <ms> tone <pin> <Hz>|off
+    <ms> led <g> <r> <b> <w>      In RGBW field order, led:<n> for the pixel
+                                  of reader n
+    <ms> serial <hex>             Bytes sent on the serial line
+
+  Usage: program [options] [eeprom image]
+
+    -q            Do not print output changes
+    -s <us>       Time per SPI register access (default 15)
+    -r <us>       Time per RF frame exchange (default 300)
+    -g <members>  Generate a benchmark trace instead of reading stdin:
+                  register a Master, add this many users, then badge
+    -n <count>    Badge events of the generated trace (default 1000), with
+                  several readers each presents a Tag at all of them at once
+    -l <percent>  Share of 7 byte UIDs in the generated trace (default 0)
+    -m <percent>  Share of badge events by members (default about 80)
+    -z <s>        Members badge by Zipf's law with exponent s: the member of
+                  rank k comes k^-s as often as the first (default uniform)
+    -f <file>     FRAM image, loaded and saved like the EEPROM image
+    -c            Check the application invariants while running
+    -x <seed>     Generate a random trace of -n steps instead of reading
+                  stdin and check it like -c: Tags from a small set with
+                  long UIDs sharing keys, held around the keying times at
+                  any reader, provisioning sessions and serial requests
+    -a <pixels>   Benchmark the LED animation player instead: play -n
+                  frames, one per ms, on this many pixels with a fade
+                  each and map them through the gamma table, print the
+                  host time (and TSC cycles on x86) per frame
+    -p <n>        Cut the power after every n-th EEPROM cell write since
+                  power-up, setup() included, and every n-th FRAM write
+                  in setup(), see power cuts below
+
+  An optional EEPROM image file is loaded at start and saved at the end,
+  so consecutive runs behave like power cycles.
+
+  Each reader call costs simulated time for its SPI register accesses and
+  RF frames, each EEPROM byte read and cell written costs its access time,
+  each FRAM transfer its opcode, address and data bytes on the SPI bus,
+  each LED sync the pixels up to the last changed one, like the SK6812
+  library; syncs without a change are counted as elided.
+  The statistics printed at the end cover every decision, the time from a
+  Tag entering the field to the opener switching or the buzzer sounding,
+  with the SPI accesses and EEPROM and FRAM bytes read on the way, and the
+  Whitelist lookups counted by the application through halCount(); the
+  reader calls are counted over the whole run: wake-ups, selects and
+  block reads (authenticate and read). An
+  output counts for the reader the application talked to last; with
+  several readers the costs of a decision include work for the others
+  done meanwhile, and latencies are also reported per reader.
+
+  The invariant checks call invariantCheck() of the application after each
+  tick with trace events, outputs or writes, outside of the simulated
+  time: Whitelist, grant cache and Master have to agree with each other,
+  and after every EEPROM write also with what a power cycle would bring
+  back from the store. The first violation
+  is printed with the seed of a random trace and ends the run with exit
+  code 2, the images are saved. A pre-release gate runs many seeds on a
+  build with -fsanitize=address,undefined, which also catches writes out
+  of bounds:
+
+    for s in $(seq 1 1000); do program -q -x $s || break; done
+
+  Power cuts (-p) play the run in a child process, which sends the
+  EEPROM image (and the FRAM image once written) before and after
+  setup(), at the start of every store append and FRAM write, at the
+  end, and right after every n-th cell write, or FRAM write in setup()
+  while a new table is filled. Each cut is one power loss on its own:
+  the write finished, or the cell reads erased when the cut came during
+  it, and each of both images is booted with setup() in a fresh child of
+  the untouched process. Master and Whitelist of the boot (stateDigest()
+  of the application) have to equal those a boot of the image before or
+  after the interrupted write brings back; a cut during setup(), such as
+  in the conversion of an old EEPROM image or the fill of the FRAM
+  table, has to bring what the full boot brought. Printed are the cuts
+  recovered to before and after, the failures with the write they cut,
+  the time from the first EEPROM read to the end of setup() over the
+  boots of cuts after it, and how the cell writes of the run spread over
+  the store slots. Failures end the run with exit code 2:
+
+    program -q -x 1 -n 500 -p 1
+
+  Built for pio test -e native there is no main(), the tests in test/ run
+  simMain() on their own traces and check the output lines, see
+  test/simRun.h.
+*/
+
+//==================== Defines ====================
+
+#define SIM_EEPROM_SIZE 1024
+#define SIM_PINS 32
+
+/*Content of block 2 on Master Tags*/
+#define SIM_MASTER_BLOCK "MasterMediumCard"
+
+/*Register accesses of the MFRC522 library calls behind each reader function*/
+#define SIM_SPI_TIMEOUT 2       // TReloadRegH/L
+#define SIM_SPI_TRANSCEIVE 14   // PCD_CommunicateWithPICC without polling
+#define SIM_SPI_CRC 8           // PCD_CalculateCRC
+#define SIM_SPI_STOPCRYPTO 2
+
+/*MFRC522 receive timeout of a poll in us, see hal_avr.cpp*/
+#define SIM_POLL_TIMEOUT 1000
+
+/*Read of one EEPROM byte, erase and write of one EEPROM cell in us*/
+#define SIM_EEPROM_READ 1
+#define SIM_EEPROM_WRITE 3400
+
+/*FRAM transfer: opcode and address bytes, time per byte in us*/
+#define SIM_FRAM_COMMAND 4
+#define SIM_FRAM_BYTE 2
+
+/*SK6812 pixel sent: 32 bits of 1.25 us in us*/
+#define SIM_LED_PIXEL 40
+
+/*Longest a wait line holds the trace in ms*/
+#define SIM_WAIT_TIMEOUT 10000
+
+/*Generated trace: Tag in the field and pause between Tags in ms*/
+#define SIM_GEN_PRESENT 250
+#define SIM_GEN_GAP 400
+#define SIM_GEN_MASTER "A0B0C0D0"
+
+/*Received serial bytes not yet read*/
+#define SIM_SERIAL_SIZE 256
+
+/*Latencies kept for the percentiles*/
+#define SIM_SAMPLES 100000
+
+/*Power cuts: message kinds sent to the root process, erased EEPROM cell*/
+#define SIM_CUT_BOUNDARY 0
+#define SIM_CUT_WRITE 1
+#define SIM_CUT_FRAM 2
+#define SIM_ERASED 0xFF
+
+/*Random trace: line length, Tags badged (two Masters first), FNV-1a prime of uidKey()*/
+#define SIM_LINE_SIZE 160
+#define SIM_FUZZ_TAGS 10
+#define SIM_FUZZ_PRIME 16777619UL
+
+//==================== Objects ====================
+
+/*struct for the Tag currently in the field*/
+typedef struct
+{
+  bool present;
+  bool master;
+  tagUID_t UID;
+} simTag_t;
+
+/*struct for one line of the trace*/
+typedef struct
+{
+  unsigned long time;
+  bool end;
+  bool mark;
+  int wait;                     // Frame type waited for, -1 if none
+  unsigned char reader;         // Reader of tag and none lines
+  simTag_t tag;
+  unsigned char serial[SIM_SERIAL_SIZE / 4];
+  unsigned char serialLength;
+} simEvent_t;
+
+/*struct for the benchmark counters*/
+typedef struct
+{
+  unsigned long decisions;
+  unsigned long undecided;      // Tags that left without any output
+  unsigned long spi;            // Register accesses of all decisions
+  unsigned long eepromReads;    // EEPROM bytes read by all decisions
+  unsigned long framReads;      // FRAM bytes read by all decisions
+  unsigned long eepromWrites;   // EEPROM bytes written in total
+  unsigned long wakeups;        // Reader calls in total: WUPA polls
+  unsigned long selects;        // Anticollision and select of a Tag
+  unsigned long blockReads;     // Authenticate and read of a block
+  unsigned long counts[HAL_COUNTERS];
+  unsigned long samples[SIM_SAMPLES];
+  unsigned char sampleReaders[SIM_SAMPLES];
+} simStats_t;
+
+/*struct for a line of a random trace, sorted by time before it is read*/
+typedef struct
+{
+  unsigned long time;
+  unsigned long order;          // Keeps lines of the same time in order
+  char text[SIM_LINE_SIZE];
+} simLine_t;
+
+/*struct for a Tag waiting at a reader for its decision*/
+typedef struct
+{
+  bool waiting;                 // A Tag arrived and no output followed yet
+  unsigned long time;
+  unsigned long spi;
+  unsigned long reads;
+  unsigned long framReads;
+} simArrival_t;
+
+/*struct for an EEPROM image sent to the root process, the FRAM image follows if fram is set*/
+typedef struct
+{
+  unsigned char kind;
+  bool fram;
+  bool setup;                   // Sent before the end of setup()
+  unsigned int cell;            // Cell written last at a cut, FRAM address of the transfer
+  unsigned long write;          // Cell writes (FRAM transfers) since power-up
+  unsigned long time;           // ms
+  unsigned char eeprom[SIM_EEPROM_SIZE];
+} simCut_t;
+
+/*struct for a cut waiting for the boundary after it*/
+typedef struct
+{
+  unsigned long digest;
+  unsigned long write;
+  unsigned long time;
+  unsigned char kind;
+  unsigned int cell;
+  bool erased;
+} simCutBoot_t;
+
+//==================== Function Prototypes ====================
+
+void setup();
+void loop();
+const char *invariantCheck(bool store);
+unsigned long stateDigest();
+
+int simMain(int argc, char **argv);
+bool simRead(simEvent_t *event);
+unsigned char simHex(const char *text, unsigned char *bytes, unsigned char size);
+void simAdvance();
+void simFinish();
+void simLoad(const char *name, unsigned char *image, unsigned long size);
+void simSave(const char *name, const unsigned char *image, unsigned long size);
+void simReader(unsigned int spi, unsigned int frames, unsigned long wait);
+void simDecide();
+void simGenerate(unsigned int members, unsigned long count, unsigned int longShare, int memberShare, double zipf);
+unsigned long simUser(unsigned long event, unsigned int members, int memberShare, const double *weights);
+unsigned long simZipf(const double *weights, unsigned int members);
+const char *simSuffix(unsigned char reader);
+void simFuzz(unsigned long seed, unsigned long count);
+unsigned long simFuzzHold();
+void simFuzzFrame(simLine_t *line, unsigned char type, const tagUID_t *UIDs, unsigned char count, unsigned char flags);
+void simCollide(tagUID_t *UID, const tagUID_t *other);
+void simLineAdd(simLine_t *lines, unsigned long *count, unsigned long time, const char *text);
+int simLineCompare(const void *a, const void *b);
+void simCheck(bool store);
+void simAnimate(unsigned int pixels, unsigned long frames);
+bool simCutFork();
+int simCutCheck();
+void simCutSend(unsigned char kind, unsigned int cell);
+bool simCutClassify(const simCutBoot_t *cut, unsigned long before, unsigned long after, unsigned long *counts);
+bool simBoot(const unsigned char *image, unsigned long *digest, unsigned long *recovery);
+void simPipeWrite(int pipe, const void *data, unsigned long length);
+bool simPipeRead(int pipe, void *data, unsigned long length);
+unsigned long simCounter(unsigned char counter);
+void simReport();
+void simLatency(const char *name, unsigned long *samples, unsigned long count);
+int simCompare(const void *a, const void *b);
+
+//==================== Global Variables ====================
+
+/*Clock*/
+unsigned long simMicros = 0;
+unsigned int simTickPeriod = 1;
+
+/*Trace*/
+FILE *simInput = 0;
+simEvent_t simNext = {0};
+bool simPending = 0;
+simTag_t simTag[HAL_READERS] = {0};
+unsigned char simReaderActive = 0; // Reader the application talked to last
+int simWait = -1;                   // Frame type the trace waits for, -1 if none
+unsigned long simWaitStart = 0;
+
+/*Options*/
+bool simQuiet = 0;
+unsigned int simSpiTime = 15;
+unsigned int simRadioTime = 300;
+
+/*Devices*/
+unsigned char simEeprom[SIM_EEPROM_SIZE];
+const char *simEepromFile = 0;
+unsigned char simFram[HAL_FRAM_SIZE];
+const char *simFramFile = 0;
+bool simPins[SIM_PINS] = {0};
+unsigned int simTone = 0;
+RGBW simLed[HAL_READERS] = {0};
+unsigned char simLedDirtyEnd = HAL_READERS;  // Pixels up to this one are sent with the next sync
+unsigned long simLedSent = 0;
+unsigned long simLedElided = 0;
+unsigned char simSerial[SIM_SERIAL_SIZE];
+unsigned int simSerialHead = 0;
+unsigned int simSerialTail = 0;
+
+/*Benchmark*/
+simStats_t simStats = {0};
+unsigned long simSpi = 0;           // Register accesses since power-up
+unsigned long simEepromReads = 0;   // EEPROM bytes read since power-up
+unsigned long simFramReads = 0;     // FRAM bytes read since power-up
+simArrival_t simArrival[HAL_READERS] = {0};
+
+/*Invariant checks*/
+bool simChecking = 0;
+bool simRunning = 0;                // Set once setup() is done
+unsigned long simSeed = 0;
+unsigned long simChecks = 0;
+unsigned long simStoreChecks = 0;
+unsigned long simWrites = 0;        // EEPROM cells written since power-up
+unsigned long simCheckedWrites = 0;
+bool simChanged = 0;                // Trace events, outputs or writes since the last check
+
+/*Power cuts*/
+unsigned long simCutEvery = 0;      // Cut after every n-th cell write (FRAM transfer in setup()), 0 for none
+unsigned long simFramWrites = 0;    // FRAM transfers in setup()
+int simCutPipe = -1;                // Run to root process, set in the child playing the run
+int simCutInput = -1;               // Read end in the root process
+int simBootPipe[2] = {-1, -1};      // Boots to root process: digest and recovery time
+pid_t simCutRunner = 0;
+bool simBooting = 0;                // Boot of a cut image, the trace is not played
+bool simBootRead = 0;               // EEPROM read since boot
+unsigned long simBootStart = 0;     // Time of the first EEPROM read
+bool simFramWritten = 0;
+unsigned long simCellWrites[SIM_EEPROM_SIZE] = {0};
+
+
+//==================== Simulator ====================
+
+#ifndef PIO_UNIT_TESTING
+int main(int argc, char **argv)
+{
+  return simMain(argc, argv);
+}
+#endif
+
+//Runs the simulator with command line options, the tests in test/ call it in a child process
+int simMain(int argc, char **argv)
+{
+  long members = -1;
+  unsigned long count = 1000;
+  unsigned int longShare = 0;
+  int memberShare = -1;
+  double zipf = 0;
+  bool fuzz = 0;
+  long pixels = -1;
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-q") == 0) simQuiet = 1;
+    else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc) simSpiTime = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) simRadioTime = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-g") == 0 && i + 1 < argc) members = atol(argv[++i]);
+    else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) count = atol(argv[++i]);
+    else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc) longShare = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) memberShare = atoi(argv[++i]);
+    else if (strcmp(argv[i], "-z") == 0 && i + 1 < argc) zipf = atof(argv[++i]);
+    else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc) simFramFile = argv[++i];
+    else if (strcmp(argv[i], "-c") == 0) simChecking = 1;
+    else if (strcmp(argv[i], "-a") == 0 && i + 1 < argc) pixels = atol(argv[++i]);
+    else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc) simCutEvery = strtoul(argv[++i], 0, 10);
+    else if (strcmp(argv[i], "-x") == 0 && i + 1 < argc)
+    {
+      simSeed = strtoul(argv[++i], 0, 10);
+      fuzz = 1;
+      simChecking = 1;
+    }
+    else simEepromFile = argv[i];
+  }
+
+  if (pixels > 0)
+  {
+    simAnimate(pixels, count);
+    return 0;
+  }
+
+  // The root process stays as it is to boot the cut images, a child plays the run
+  if (simCutEvery != 0 && simCutFork()) return simCutCheck();
+
+  simLoad(simEepromFile, simEeprom, sizeof(simEeprom));
+  simLoad(simFramFile, simFram, sizeof(simFram));
+
+  simInput = stdin;
+  if (fuzz) simFuzz(simSeed, count);
+  else if (members >= 0) simGenerate(members, count, longShare, memberShare, zipf);
+
+  simPending = simRead(&simNext);
+  simAdvance();
+
+  // A boot cut off anywhere in setup() has to bring what a full boot brings
+  simCutSend(SIM_CUT_BOUNDARY, 0);
+  setup();
+  simRunning = 1;
+  simCutSend(SIM_CUT_BOUNDARY, 0);
+  while (1) loop();
+}
+
+//Reads the next event from the trace, returns 0 at the end of the input
+bool simRead(simEvent_t *event)
+{
+  char line[256];
+
+  while (fgets(line, sizeof(line), simInput))
+  {
+    char command[16] = {0};
+    char argument[2 * sizeof(event->serial) + 1] = {0};
+    char flag[16] = {0};
+    unsigned long time;
+
+    if (line[0] == '#' || sscanf(line, "%lu %15s %128s %15s", &time, command, argument, flag) < 2) continue;
+
+    memset(event, 0, sizeof(simEvent_t));
+    event->time = time;
+    event->wait = -1;
+
+    // Reader after a colon, reader 0 without
+    char *colon = strchr(command, ':');
+    if (colon)
+    {
+      *colon = 0;
+      event->reader = atoi(colon + 1);
+      if (event->reader >= HAL_READERS) continue;
+    }
+
+    if (strcmp(command, "end") == 0)
+    {
+      event->end = 1;
+      return 1;
+    }
+    if (strcmp(command, "mark") == 0)
+    {
+      event->mark = 1;
+      return 1;
+    }
+    if (strcmp(command, "serial") == 0)
+    {
+      event->serialLength = simHex(argument, event->serial, sizeof(event->serial));
+      return 1;
+    }
+    if (strcmp(command, "wait") == 0)
+    {
+      unsigned char type;
+      if (simHex(argument, &type, 1) != 1) continue;
+
+      event->wait = type;
+      return 1;
+    }
+    if (strcmp(command, "none") == 0) return 1;
+    if (strcmp(command, "tag") != 0) continue;
+
+    unsigned char bytes[UID_MAX_SIZE];
+    unsigned char size = simHex(argument, bytes, UID_MAX_SIZE);
+    if (size != 4 && size != 7 && size != 10) continue;
+
+    event->tag.present = 1;
+    event->tag.master = strcmp(flag, "master") == 0;
+    uidSet(&event->tag.UID, bytes, size);
+    return 1;
+  }
+  return 0;
+}
+
+//Converts a hex string to at most size bytes, returns their number
+unsigned char simHex(const char *text, unsigned char *bytes, unsigned char size)
+{
+  unsigned char length = 0;
+
+  while (length < size && text[2 * length] && text[2 * length + 1])
+  {
+    unsigned int value;
+    if (sscanf(&text[2 * length], "%2x", &value) != 1) break;
+    bytes[length++] = value;
+  }
+  return length;
+}
+
+//Applies all events due by now, ends the simulation after the last one
+void simAdvance()
+{
+  if (simBooting) return;
+
+  if (simWait >= 0 && simMicros - simWaitStart > SIM_WAIT_TIMEOUT * 1000UL)
+  {
+    if (!simQuiet) printf("%8lu wait timeout\n", simMicros / 1000);
+    simWait = -1;
+  }
+
+  while (simWait < 0 && simPending && simNext.time * 1000 <= simMicros)
+  {
+    if (simNext.end) simFinish();
+
+    if (simNext.wait >= 0)
+    {
+      simWait = simNext.wait;
+      simWaitStart = simMicros;
+    }
+    else if (simNext.mark)
+    {
+      memset(&simStats, 0, sizeof(simStats));
+    }
+    else if (simNext.serialLength)
+    {
+      for (unsigned char i = 0; i < simNext.serialLength; i++)
+      {
+        simSerial[simSerialHead] = simNext.serial[i];
+        simSerialHead = (simSerialHead + 1) % SIM_SERIAL_SIZE;
+      }
+    }
+    else
+    {
+      // A Tag leaving without any output was not decided
+      simArrival_t *arrival = &simArrival[simNext.reader];
+      if (arrival->waiting && !simNext.tag.present) simStats.undecided++;
+
+      arrival->waiting = simNext.tag.present;
+      arrival->time = simNext.time * 1000;
+      arrival->spi = simSpi;
+      arrival->reads = simEepromReads;
+      arrival->framReads = simFramReads;
+      simTag[simNext.reader] = simNext.tag;
+    }
+    simPending = simRead(&simNext);
+    simChanged = 1;
+  }
+
+  if (!simPending && simWait < 0) simFinish();
+}
+
+//Saves the EEPROM image, prints the statistics and stops
+void simFinish()
+{
+  simCheck(1);
+  simCutSend(SIM_CUT_BOUNDARY, 0);
+  simSave(simEepromFile, simEeprom, sizeof(simEeprom));
+  simSave(simFramFile, simFram, sizeof(simFram));
+
+  if (!simQuiet) printf("%8lu end\n", simMicros / 1000);
+  if (simChecking) printf("invariant checks %lu with store %lu passed\n", simChecks, simStoreChecks);
+  simReport();
+  exit(0);
+}
+
+//Checks the application invariants after something happened, the store only when asked or written since; costs no simulated time
+void simCheck(bool store)
+{
+  if (!simChecking || !simRunning || (!store && !simChanged)) return;
+  simChanged = 0;
+
+  unsigned long micros = simMicros;
+  unsigned long reads = simEepromReads;
+  unsigned long framReads = simFramReads;
+  unsigned long counts[HAL_COUNTERS];
+  memcpy(counts, simStats.counts, sizeof(counts));
+
+  store = store || simWrites != simCheckedWrites;
+  simCheckedWrites = simWrites;
+  const char *violation = invariantCheck(store);
+
+  simMicros = micros;
+  simEepromReads = reads;
+  simFramReads = framReads;
+  memcpy(simStats.counts, counts, sizeof(counts));
+  simChecks++;
+  if (store) simStoreChecks++;
+  if (!violation) return;
+
+  printf("%8lu check failed: %s\n", simMicros / 1000, violation);
+  if (simSeed != 0) printf("seed %lu\n", simSeed);
+  simSave(simEepromFile, simEeprom, sizeof(simEeprom));
+  simSave(simFramFile, simFram, sizeof(simFram));
+  exit(2);
+}
+
+//Loads a memory image, a missing or short file leaves the memory erased
+void simLoad(const char *name, unsigned char *image, unsigned long size)
+{
+  memset(image, 0xFF, size);
+  if (!name) return;
+
+  FILE *file = fopen(name, "rb");
+  if (!file) return;
+
+  if (fread(image, 1, size, file) != size) memset(image, 0xFF, size);
+  fclose(file);
+}
+
+//Saves a memory image, if a file was given
+void simSave(const char *name, const unsigned char *image, unsigned long size)
+{
+  if (!name) return;
+
+  FILE *file = fopen(name, "wb");
+  if (!file) return;
+
+  fwrite(image, 1, size, file);
+  fclose(file);
+}
+
+//Charges the cost of one reader call
+void simReader(unsigned int spi, unsigned int frames, unsigned long wait)
+{
+  simSpi += spi;
+  simMicros += spi * simSpiTime + frames * simRadioTime + wait;
+}
+
+//Records the first output after a Tag arrived at the active reader as its decision
+void simDecide()
+{
+  simArrival_t *arrival = &simArrival[simReaderActive];
+
+  if (!arrival->waiting) return;
+  arrival->waiting = 0;
+
+  if (simStats.decisions < SIM_SAMPLES)
+  {
+    simStats.samples[simStats.decisions] = simMicros - arrival->time;
+    simStats.sampleReaders[simStats.decisions] = simReaderActive;
+  }
+  simStats.decisions++;
+  simStats.spi += simSpi - arrival->spi;
+  simStats.eepromReads += simEepromReads - arrival->reads;
+  simStats.framReads += simFramReads - arrival->framReads;
+}
+
+//Writes a benchmark trace to a temporary file and reads from there
+void simGenerate(unsigned int members, unsigned long count, unsigned int longShare, int memberShare, double zipf)
+{
+  unsigned long time = 1000;
+  double *weights = 0;
+
+  simInput = tmpfile();
+  if (!simInput)
+  {
+    perror("tmpfile");
+    exit(1);
+  }
+  srand(1);
+
+  // Running sums of rank^-s, drawn from by simZipf()
+  if (zipf > 0 && members != 0)
+  {
+    weights = (double *)malloc(members * sizeof(double));
+    for (unsigned int rank = 0; rank < members; rank++)
+      weights[rank] = (rank != 0 ? weights[rank - 1] : 0) + pow(rank + 1, -zipf);
+  }
+
+  // Master registers at reader 0 and opens keying, every user presented while keying is added
+  fprintf(simInput, "%lu tag %s master\n", time, SIM_GEN_MASTER);
+  fprintf(simInput, "%lu none\n", time += SIM_GEN_PRESENT);
+
+  for (unsigned long event = 0; event < members + count; event++)
+  {
+    // Badge events present a Tag at every reader at once
+    unsigned char readers = event < members ? 1 : HAL_READERS;
+    unsigned long users[HAL_READERS];
+    for (unsigned char reader = 0; reader < readers; reader++)
+      users[reader] = simUser(event, members, memberShare, weights);
+
+    if (event == members)
+    {
+      // Let keying time out, then measure
+      time += 11000;
+      fprintf(simInput, "%lu mark\n", time);
+    }
+
+    time += SIM_GEN_GAP + rand() % SIM_GEN_GAP;
+    for (unsigned char reader = 0; reader < readers; reader++)
+    {
+      unsigned long user = users[reader];
+      unsigned int size = (user * 37 % 100) < longShare ? 7 : 4;
+
+      fprintf(simInput, "%lu tag%s %02X%02lX%02lX%02lX", time, simSuffix(reader), 0x10 + size, user >> 16 & 0xFF, user >> 8 & 0xFF, user & 0xFF);
+      for (unsigned int i = 4; i < size; i++) fprintf(simInput, "%02lX", (user * 7 + i) & 0xFF);
+      fprintf(simInput, "\n");
+    }
+
+    time += SIM_GEN_PRESENT;
+    for (unsigned char reader = 0; reader < readers; reader++)
+      fprintf(simInput, "%lu none%s\n", time, simSuffix(reader));
+  }
+
+  fprintf(simInput, "%lu end\n", time + 2000);
+  rewind(simInput);
+  free(weights);
+}
+
+//Writes a random trace to a temporary file and reads from there
+void simFuzz(unsigned long seed, unsigned long count)
+{
+  simLine_t *lines = (simLine_t *)malloc((4 * count + 1) * sizeof(simLine_t));
+  unsigned long lineCount = 0;
+  unsigned long time = 1000;
+  unsigned long busy[HAL_READERS] = {0};  // Reader has a Tag until then
+  tagUID_t tags[SIM_FUZZ_TAGS];
+  const unsigned char bytes[] = {0x04, 0xA1, 0xB2, 0xC3, 0xD4, 0xE5, 0xF6, 0x07, 0x18, 0x29};
+  char text[SIM_LINE_SIZE];
+
+  simInput = tmpfile();
+  if (!simInput || !lines)
+  {
+    perror("simFuzz");
+    exit(1);
+  }
+  srand(seed);
+
+  // Two Masters, users of all UID sizes; same head in three sizes, and two long UIDs sharing one key
+  uidSet(&tags[0], (const unsigned char *)"\xA0\xB0\xC0\xD0", 4);
+  uidSet(&tags[1], (const unsigned char *)"\x11\x22\x33\x44", 4);
+  uidSet(&tags[2], (const unsigned char *)"\x01\x02\x03\x04", 4);
+  uidSet(&tags[3], (const unsigned char *)"\x0A\x0B\x0C\x0D", 4);
+  uidSet(&tags[4], bytes, 4);
+  uidSet(&tags[5], bytes, 7);
+  uidSet(&tags[6], bytes, 10);
+  uidSet(&tags[7], &bytes[3], 7);
+  tags[8] = tags[5];
+  tags[8].tail[2] ^= 0x5A;
+  simCollide(&tags[8], &tags[5]);
+  tags[9] = tags[6];
+  tags[9].head = uidKey(&tags[6]);
+  tags[9].size = 4;
+  memset(tags[9].tail, 0, UID_TAIL_SIZE);
+
+  for (unsigned long step = 0; step < count; step++)
+  {
+    unsigned int kind = rand() % 100;
+    time += rand() % 1000;
+
+    if (kind < 70)
+    {
+      // Badge at any reader once its last Tag left, strangers now and then
+      unsigned char reader = rand() % HAL_READERS;
+      unsigned long start = busy[reader] > time ? busy[reader] : time;
+      unsigned long hold = simFuzzHold();
+      unsigned int pick = rand() % 100;
+      tagUID_t UID = tags[pick < 25 ? 0 : pick < 30 ? 1 : 2 + rand() % (SIM_FUZZ_TAGS - 2)];
+      unsigned char raw[UID_MAX_SIZE];
+
+      if (pick >= 95) UID.head = rand();
+      unsigned char size = uidBytes(&UID, raw);
+
+      int length = snprintf(text, sizeof(text), "tag%s ", simSuffix(reader));
+      for (unsigned char i = 0; i < size; i++) length += snprintf(&text[length], sizeof(text) - length, "%02X", raw[i]);
+      if (pick < 30) snprintf(&text[length], sizeof(text) - length, " master");
+      simLineAdd(lines, &lineCount, start, text);
+
+      snprintf(text, sizeof(text), "none%s", simSuffix(reader));
+      simLineAdd(lines, &lineCount, start + hold, text);
+      busy[reader] = start + hold + 20 + rand() % 100;
+    }
+    else if (kind < 85)
+    {
+      // Provisioning session, taken only while a reader is keying
+      tagUID_t batch[3];
+      simLine_t frame;
+
+      simFuzzFrame(&frame, FRAME_PROVISION_BEGIN, 0, 0, rand() % 5 == 0 ? PROVISION_REPLACE : 0);
+      simLineAdd(lines, &lineCount, time, frame.text);
+
+      for (unsigned char type = FRAME_PROVISION_ADD; type <= FRAME_PROVISION_REMOVE; type++)
+      {
+        unsigned char size = rand() % 4;
+        for (unsigned char i = 0; i < size; i++) batch[i] = tags[2 + rand() % (SIM_FUZZ_TAGS - 2)];
+
+        simFuzzFrame(&frame, type, batch, size, 0);
+        simLineAdd(lines, &lineCount, time += 5, frame.text);
+      }
+
+      simFuzzFrame(&frame, FRAME_PROVISION_END, 0, 0, 0);
+      simLineAdd(lines, &lineCount, time += 5, frame.text);
+    }
+    else if (kind < 90)
+    {
+      snprintf(text, sizeof(text), "serial %02X", rand() % 2 ? TELEMETRY_REQUEST : TELEMETRY_STATUS_REQUEST);
+      simLineAdd(lines, &lineCount, time, text);
+    }
+    else
+    {
+      // Quiet long enough for keying to time out
+      time += 9000 + rand() % 4000;
+    }
+  }
+
+  qsort(lines, lineCount, sizeof(simLine_t), simLineCompare);
+  for (unsigned long i = 0; i < lineCount; i++)
+  {
+    if (lines[i].time > time) time = lines[i].time;
+    fprintf(simInput, "%lu %s\n", lines[i].time, lines[i].text);
+  }
+
+  fprintf(simInput, "%lu end\n", time + 20000);
+  rewind(simInput);
+  free(lines);
+}
+
+//Draws how long a Tag is held in ms: mostly a tap, else around the keying times
+unsigned long simFuzzHold()
+{
+  switch (rand() % 8)
+  {
+    case 4:
+      return 4500 + rand() % 1000;
+    case 5:
+      return 9500 + rand() % 1000;
+    case 6:
+      return 12500 + rand() % 1000;
+    case 7:
+      return 14000 + rand() % 2000;
+    default:
+      return 100 + rand() % 400;
+  }
+}
+
+//Writes a serial line with a provisioning frame: batch number and UIDs, or the flags of a begin
+void simFuzzFrame(simLine_t *line, unsigned char type, const tagUID_t *UIDs, unsigned char count, unsigned char flags)
+{
+  unsigned char frame[FRAME_RX_PAYLOAD_MAX + 4];
+  unsigned char length = 3;
+
+  frame[0] = FRAME_SYNC;
+  frame[1] = type;
+  if (type == FRAME_PROVISION_BEGIN) frame[length++] = flags;
+  if (type == FRAME_PROVISION_ADD || type == FRAME_PROVISION_REMOVE) frame[length++] = rand();
+
+  for (unsigned char i = 0; i < count; i++)
+  {
+    frame[length] = uidBytes(&UIDs[i], &frame[length + 1]);
+    length += 1 + frame[length];
+  }
+  frame[2] = length - 3;
+  frame[length] = crc8(&frame[1], length - 1);
+  length++;
+
+  int used = snprintf(line->text, sizeof(line->text), "serial ");
+  for (unsigned char i = 0; i < length; i++) used += snprintf(&line->text[used], sizeof(line->text) - used, "%02X", frame[i]);
+}
+
+//Sets the head of a long UID so its key equals the key of other, runs the FNV-1a steps of uidKey() backwards
+void simCollide(tagUID_t *UID, const tagUID_t *other)
+{
+  // Newton's iteration for the inverse of the prime modulo 2^32
+  uint32_t inverse = SIM_FUZZ_PRIME;
+  for (unsigned char i = 0; i < 4; i++) inverse *= 2 - SIM_FUZZ_PRIME * inverse;
+
+  uint32_t key = uidKey(other);
+  for (unsigned char i = UID->size; i > 4; i--) key = (uint32_t)(key * inverse) ^ UID->tail[i - 5];
+  UID->head = key;
+}
+
+//Appends a line to a random trace
+void simLineAdd(simLine_t *lines, unsigned long *count, unsigned long time, const char *text)
+{
+  lines[*count].time = time;
+  lines[*count].order = *count;
+  snprintf(lines[*count].text, sizeof(lines[*count].text), "%s", text);
+  (*count)++;
+}
+
+int simLineCompare(const void *a, const void *b)
+{
+  const simLine_t *x = (const simLine_t *)a;
+  const simLine_t *y = (const simLine_t *)b;
+  if (x->time != y->time) return x->time < y->time ? -1 : 1;
+  return x->order < y->order ? -1 : x->order > y->order;
+}
+
+//Picks the user of a badge event: users 0 to members - 1 are added first, the rest badge as strangers
+unsigned long simUser(unsigned long event, unsigned int members, int memberShare, const double *weights)
+{
+  unsigned long user = event < members ? event : rand() % (members * 5 / 4 + 1);
+  if (event >= members && memberShare >= 0)
+  {
+    if (members != 0 && rand() % 100 < memberShare) user = rand() % members;
+    else user = members + rand() % 0x10000;
+  }
+  if (weights && event >= members && user < members) user = simZipf(weights, members);
+  return user;
+}
+
+//Draws a member by the running sums of its weights
+unsigned long simZipf(const double *weights, unsigned int members)
+{
+  double target = weights[members - 1] * rand() / ((double)RAND_MAX + 1);
+  unsigned long low = 0, high = members - 1;
+
+  while (low < high)
+  {
+    unsigned long middle = (low + high) / 2;
+    if (weights[middle] <= target) low = middle + 1;
+    else high = middle;
+  }
+  return low;
+}
+
+//Plays an animation on each pixel frame after frame and prints the cost of a frame
+void simAnimate(unsigned int pixels, unsigned long frames)
+{
+  static const ledKeyframe_t keyframes[] = {
+    LED_KEYFRAME(255, 40, 0, 0, 700), LED_KEYFRAME(0, 255, 90, 10, 300), LED_KEYFRAME(0, 0, 0, 0, 1000)};
+  static const ledAnimation_t animation = LED_ANIMATION(keyframes);
+
+  ledAnim_t *anims = (ledAnim_t *)malloc(pixels * sizeof(ledAnim_t));
+  unsigned long sum = 0;  // Keeps the frames from being optimised away
+
+  // Pixels start apart so they are at different points of their fades
+  for (unsigned int pixel = 0; pixel < pixels; pixel++) ledAnimStart(&anims[pixel], &animation, pixel * 37);
+
+  struct timespec start, stop;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+#ifdef SIM_CYCLES
+  unsigned long long cycles = SIM_CYCLES();
+#endif
+
+  for (unsigned long frame = 0; frame < frames; frame++)
+  {
+    for (unsigned int pixel = 0; pixel < pixels; pixel++)
+    {
+      RGBW color = ledColor(ledAnimFrame(&anims[pixel], frame + pixels * 37));
+      sum += color.g + color.r + color.b + color.w;
+    }
+  }
+
+#ifdef SIM_CYCLES
+  cycles = SIM_CYCLES() - cycles;
+#endif
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  double ns = (stop.tv_sec - start.tv_sec) * 1e9 + (stop.tv_nsec - start.tv_nsec);
+
+  printf("animation pixels %u frames %lu: %.1f ns", pixels, frames, frames ? ns / frames : 0);
+#ifdef SIM_CYCLES
+  printf(", %.0f cycles", frames ? (double)cycles / frames : 0);
+#endif
+  printf(" per frame (levels %lu)\n", sum);
+  free(anims);
+}
+
+//Sets up the pipes and forks the child playing the run, returns 1 in the root process
+bool simCutFork()
+{
+  int run[2];
+
+  if (pipe(run) != 0 || pipe(simBootPipe) != 0)
+  {
+    perror("pipe");
+    exit(1);
+  }
+  fflush(stdout);
+
+  simCutRunner = fork();
+  if (simCutRunner < 0)
+  {
+    perror("fork");
+    exit(1);
+  }
+  if (simCutRunner == 0)
+  {
+    close(run[0]);
+    close(simBootPipe[0]);
+    close(simBootPipe[1]);
+    simCutPipe = run[1];
+    return 0;
+  }
+
+  close(run[1]);
+  simCutInput = run[0];
+  return 1;
+}
+
+//Boots the images the run sends and checks each cut against the boundaries before and after it, returns the exit code
+int simCutCheck()
+{
+  simCut_t cut;
+  simCutBoot_t *pending = 0;
+  unsigned long pendingCount = 0;
+  unsigned long pendingSize = 0;
+  unsigned long counts[3] = {0};    // Recovered to before, to after, failed
+  unsigned long before = 0;
+  unsigned long boots = 0;
+  unsigned long recoverySum = 0;
+  unsigned long recoveryMax = 0;
+
+  while (simPipeRead(simCutInput, &cut, sizeof(cut)))
+  {
+    if (cut.fram && !simPipeRead(simCutInput, simFram, sizeof(simFram))) break;
+
+    // The cut came after the write of the cell finished, or during it and left the cell erased
+    for (unsigned char erased = 0; erased < (cut.kind == SIM_CUT_WRITE ? 2 : 1); erased++)
+    {
+      simCutBoot_t boot = {0, cut.write, cut.time, cut.kind, cut.cell, erased != 0};
+      unsigned long recovery;
+
+      if (erased)
+      {
+        if (cut.eeprom[cut.cell] == SIM_ERASED) break;
+        cut.eeprom[cut.cell] = SIM_ERASED;
+      }
+
+      if (!simBoot(cut.eeprom, &boot.digest, &recovery))
+      {
+        printf("%8lu boot after write %lu failed\n", cut.time, cut.write);
+        counts[2]++;
+        continue;
+      }
+      // A boot cut off in setup() may go on with its writes, only store boots count
+      if (!cut.setup)
+      {
+        boots++;
+        recoverySum += recovery;
+        if (recovery > recoveryMax) recoveryMax = recovery;
+      }
+
+      if (cut.kind != SIM_CUT_BOUNDARY)
+      {
+        if (pendingCount == pendingSize)
+        {
+          pendingSize = pendingSize * 2 + 64;
+          pending = (simCutBoot_t *)realloc(pending, pendingSize * sizeof(simCutBoot_t));
+        }
+        pending[pendingCount++] = boot;
+        continue;
+      }
+
+      for (unsigned long i = 0; i < pendingCount; i++) simCutClassify(&pending[i], before, boot.digest, counts);
+      pendingCount = 0;
+      before = boot.digest;
+    }
+  }
+
+  int status;
+  if (waitpid(simCutRunner, &status, 0) != simCutRunner || !WIFEXITED(status)) status = 1;
+  else status = WEXITSTATUS(status);
+  free(pending);
+
+  printf("power cuts %lu recovered before %lu after %lu failed %lu\n", counts[0] + counts[1] + counts[2], counts[0], counts[1], counts[2]);
+  if (boots != 0) printf("recovery us mean %.0f max %lu\n", (double)recoverySum / boots, recoveryMax);
+  if (counts[2] != 0 && simSeed != 0) printf("seed %lu\n", simSeed);
+
+  if (status != 0) return status;
+  return counts[2] != 0 ? 2 : 0;
+}
+
+//Sends the images to the root process: a boundary before a store append or at the end, or a cut after writing cell
+void simCutSend(unsigned char kind, unsigned int cell)
+{
+  if (simCutPipe < 0) return;
+
+  simCut_t cut;
+  cut.kind = kind;
+  cut.fram = simFramWritten;
+  cut.setup = !simRunning;
+  cut.cell = cell;
+  cut.write = kind == SIM_CUT_FRAM ? simFramWrites : simWrites;
+  cut.time = simMicros / 1000;
+  memcpy(cut.eeprom, simEeprom, sizeof(cut.eeprom));
+
+  simPipeWrite(simCutPipe, &cut, sizeof(cut));
+  if (cut.fram) simPipeWrite(simCutPipe, simFram, sizeof(simFram));
+}
+
+//Counts a cut as recovered to the state before or after its store append, prints it if it is neither
+bool simCutClassify(const simCutBoot_t *cut, unsigned long before, unsigned long after, unsigned long *counts)
+{
+  if (cut->digest == before) counts[0]++;
+  else if (cut->digest == after) counts[1]++;
+  else
+  {
+    if (cut->kind == SIM_CUT_FRAM) printf("%8lu power cut at FRAM write %lu (0x%05X) recovered neither state\n", cut->time, cut->write, cut->cell);
+    else printf("%8lu power cut at write %lu (cell 0x%03X %s) recovered neither state\n",
+      cut->time, cut->write, cut->cell, cut->erased ? "erased" : "written");
+    counts[2]++;
+    return 0;
+  }
+  return 1;
+}
+
+//Boots the application on an EEPROM image in a child of the root process, returns 0 if setup() did not finish
+bool simBoot(const unsigned char *image, unsigned long *digest, unsigned long *recovery)
+{
+  unsigned long result[2];
+  int status;
+
+  fflush(stdout);
+  pid_t child = fork();
+  if (child == 0)
+  {
+    memcpy(simEeprom, image, sizeof(simEeprom));
+    simQuiet = 1;
+    simBooting = 1;
+    setup();
+
+    result[0] = stateDigest();
+    result[1] = simMicros - simBootStart;
+    simPipeWrite(simBootPipe[1], result, sizeof(result));
+    _exit(0);
+  }
+
+  if (child < 0 || waitpid(child, &status, 0) != child || !WIFEXITED(status) || WEXITSTATUS(status) != 0) return 0;
+  if (!simPipeRead(simBootPipe[0], result, sizeof(result))) return 0;
+
+  *digest = result[0];
+  *recovery = result[1];
+  return 1;
+}
+
+//Writes all bytes to a pipe
+void simPipeWrite(int descriptor, const void *data, unsigned long length)
+{
+  const unsigned char *bytes = (const unsigned char *)data;
+
+  while (length > 0)
+  {
+    ssize_t written = write(descriptor, bytes, length);
+    if (written <= 0)
+    {
+      perror("simPipeWrite");
+      exit(1);
+    }
+    bytes += written;
+    length -= written;
+  }
+}
+
+//Reads exactly length bytes from a pipe, returns 0 at its end
+bool simPipeRead(int descriptor, void *data, unsigned long length)
+{
+  unsigned char *bytes = (unsigned char *)data;
+
+  while (length > 0)
+  {
+    ssize_t got = read(descriptor, bytes, length);
+    if (got <= 0) return 0;
+    bytes += got;
+    length -= got;
+  }
+  return 1;
+}
+
+//Prints decision latency percentiles and per-decision costs
+void simReport()
+{
+  unsigned long samples = simStats.decisions < SIM_SAMPLES ? simStats.decisions : SIM_SAMPLES;
+
+  printf("decisions %lu undecided %lu\n", simStats.decisions, simStats.undecided);
+  printf("eeprom bytes written %lu\n", simStats.eepromWrites);
+  printf("led syncs sent %lu elided %lu\n", simLedSent, simLedElided);
+  printf("reader wakeups %lu selects %lu block reads %lu\n", simStats.wakeups, simStats.selects, simStats.blockReads);
+
+  // Wear of the store with power cuts: cells written since power-up, summed per slot
+  if (simCutEvery != 0)
+  {
+    unsigned long least = 0, most = 0, total = 0;
+
+    for (unsigned int slot = 0; slot < STORE_SLOTS; slot++)
+    {
+      unsigned long writes = 0;
+      for (unsigned int i = 0; i < STORE_SLOT_SIZE; i++) writes += simCellWrites[STORE_BEGIN + slot * STORE_SLOT_SIZE + i];
+
+      if (slot == 0 || writes < least) least = writes;
+      if (writes > most) most = writes;
+      total += writes;
+    }
+    printf("eeprom cell writes per store slot min %lu mean %.1f max %lu\n", least, (double)total / STORE_SLOTS, most);
+  }
+  if (samples == 0) return;
+
+  // Per reader first, the overall percentiles sort the samples
+  if (HAL_READERS > 1)
+  {
+    unsigned long *own = (unsigned long *)malloc(samples * sizeof(unsigned long));
+    for (unsigned char reader = 0; reader < HAL_READERS; reader++)
+    {
+      unsigned long count = 0;
+      char name[32];
+
+      for (unsigned long i = 0; i < samples; i++)
+        if (simStats.sampleReaders[i] == reader) own[count++] = simStats.samples[i];
+      snprintf(name, sizeof(name), "reader %u latency", reader);
+      printf("reader %u decisions %lu\n", reader, count);
+      simLatency(name, own, count);
+    }
+    free(own);
+  }
+  simLatency("latency", simStats.samples, samples);
+  printf("per decision spi %.1f eeprom reads %.1f fram reads %.1f\n",
+    (double)simStats.spi / simStats.decisions, (double)simStats.eepromReads / simStats.decisions,
+    (double)simStats.framReads / simStats.decisions);
+
+  unsigned long grants = simStats.counts[HAL_COUNT_GRANT_LOOKUP];
+  if (grants != 0)
+  {
+    printf("grant cache hits %lu of %lu badges (%.1f%%)\n",
+      simStats.counts[HAL_COUNT_GRANT_HIT], grants, 100.0 * simStats.counts[HAL_COUNT_GRANT_HIT] / grants);
+  }
+
+  unsigned long lookups = simStats.counts[HAL_COUNT_LOOKUP];
+  unsigned long strangers = simStats.counts[HAL_COUNT_BLOOM_REJECT] + simStats.counts[HAL_COUNT_BLOOM_FALSE];
+  if (lookups == 0) return;
+
+  printf("lookups %lu slots probed per lookup %.2f\n", lookups, (double)simStats.counts[HAL_COUNT_PROBE] / lookups);
+  if (strangers == 0) return;
+
+  printf("bloom rejects %lu false positives %lu (%.2f%% of strangers)\n",
+    simStats.counts[HAL_COUNT_BLOOM_REJECT], simStats.counts[HAL_COUNT_BLOOM_FALSE],
+    100.0 * simStats.counts[HAL_COUNT_BLOOM_FALSE] / strangers);
+}
+
+//Prints the percentiles of some latencies, sorts them
+void simLatency(const char *name, unsigned long *samples, unsigned long count)
+{
+  if (count == 0) return;
+
+  qsort(samples, count, sizeof(unsigned long), simCompare);
+  printf("%s us p50 %lu p99 %lu max %lu\n", name, samples[count / 2], samples[count * 99 / 100], samples[count - 1]);
+}
+
+//Returns the suffix naming a reader in trace and output lines, none for reader 0
+const char *simSuffix(unsigned char reader)
+{
+  static char suffix[8];
+
+  if (reader == 0) return "";
+  snprintf(suffix, sizeof(suffix), ":%u", reader);
+  return suffix;
+}
+
+int simCompare(const void *a, const void *b)
+{
+  unsigned long x = *(const unsigned long *)a;
+  unsigned long y = *(const unsigned long *)b;
+  return x < y ? -1 : x > y;
+}
+
+
+//==================== Memory ====================
+
+void halRamMark()
+{
+}
+
+//Not known on the host
+unsigned int halFreeRam()
+{
+  return 0;
+}
+
+
+//==================== Clock ====================
+
+unsigned long halMillis()
+{
+  return simMicros / 1000;
+}
+
+unsigned long halMicros()
+{
+  return simMicros;
+}
+
+void halTickBegin(unsigned int period)
+{
+  simTickPeriod = period;
+}
+
+//Moves the simulated time on to the next tick, like the Timer1 interrupt would
+void halTickWait()
+{
+  unsigned long tick = simTickPeriod * 1000UL;
+
+  simCheck(0);
+
+  simMicros = (simMicros / tick + 1) * tick;
+  simAdvance();
+}
+
+
+//==================== GPIO and Buzzer ====================
+
+void halPinOutput(unsigned char pin)
+{
+  if (pin < SIM_PINS) simPins[pin] = 0;
+}
+
+void halPinWrite(unsigned char pin, bool high)
+{
+  if (pin >= SIM_PINS || simPins[pin] == high) return;
+
+  simPins[pin] = high;
+  simChanged = 1;
+  if (high) simDecide();
+  if (!simQuiet) printf("%8lu pin %u %s\n", simMicros / 1000, pin, high ? "high" : "low");
+}
+
+void halTone(unsigned char pin, unsigned int frequency)
+{
+  // A pattern restarted while sounding still counts as a decision
+  simDecide();
+  if (simTone == frequency) return;
+
+  simTone = frequency;
+  simChanged = 1;
+  if (!simQuiet) printf("%8lu tone %u %u\n", simMicros / 1000, pin, frequency);
+}
+
+void halNoTone(unsigned char pin)
+{
+  if (simTone == 0) return;
+
+  simTone = 0;
+  simChanged = 1;
+  if (!simQuiet) printf("%8lu tone %u off\n", simMicros / 1000, pin);
+}
+
+
+//==================== Signal LED ====================
+
+void halLedBegin()
+{
+  halPinOutput(HAL_LED_PIN);
+}
+
+void halLedShow(unsigned char pixel, RGBW color)
+{
+  if (pixel < HAL_READERS && memcmp(&color, &simLed[pixel], sizeof(RGBW)) != 0)
+  {
+    simLed[pixel] = color;
+    if (pixel >= simLedDirtyEnd) simLedDirtyEnd = pixel + 1;
+    simChanged = 1;
+    if (!simQuiet) printf("%8lu led%s %u %u %u %u\n", simMicros / 1000, simSuffix(pixel), color.g, color.r, color.b, color.w);
+  }
+
+  if (simLedDirtyEnd == 0)
+  {
+    simLedElided++;
+    return;
+  }
+
+  simMicros += simLedDirtyEnd * SIM_LED_PIXEL;
+  simLedDirtyEnd = 0;
+  simLedSent++;
+}
+
+void halLedStats(unsigned long *sent, unsigned long *elided)
+{
+  *sent = simLedSent;
+  *elided = simLedElided;
+}
+
+
+//==================== External FRAM ====================
+
+void halFramBegin()
+{
+}
+
+void halFramRead(unsigned long address, void *data, unsigned int length)
+{
+  simFramReads += length;
+  simMicros += (SIM_FRAM_COMMAND + length) * SIM_FRAM_BYTE;
+
+  for (unsigned int i = 0; i < length; i++)
+    ((unsigned char *)data)[i] = simFram[(address + i) % HAL_FRAM_SIZE];
+}
+
+//Write enable and write, no write cycle time
+void halFramWrite(unsigned long address, const void *data, unsigned int length)
+{
+  // Whitelist changes in the FRAM table are states of their own, like store appends
+  if (simRunning) simCutSend(SIM_CUT_BOUNDARY, 0);
+
+  simMicros += (1 + SIM_FRAM_COMMAND + length) * SIM_FRAM_BYTE;
+  simChanged = 1;
+  simFramWritten = 1;
+
+  for (unsigned int i = 0; i < length; i++)
+    simFram[(address + i) % HAL_FRAM_SIZE] = ((const unsigned char *)data)[i];
+
+  // Filling a new table in setup() is cut after every n-th transfer
+  if (!simRunning && simCutEvery != 0 && ++simFramWrites % simCutEvery == 0) simCutSend(SIM_CUT_FRAM, address);
+}
+
+
+//==================== Benchmark Counters ====================
+
+void halCount(unsigned char counter)
+{
+  if (counter < HAL_COUNTERS) simStats.counts[counter]++;
+
+  // Power cuts inside the append have to recover to this image or to the next one
+  if (counter == HAL_COUNT_STORE_APPEND) simCutSend(SIM_CUT_BOUNDARY, 0);
+}
+
+//Returns a counter kept by halCount(), for the tests in test/
+unsigned long simCounter(unsigned char counter)
+{
+  return counter < HAL_COUNTERS ? simStats.counts[counter] : 0;
+}
+
+
+//==================== Serial Line ====================
+
+void halSerialBegin()
+{
+}
+
+int halSerialRead()
+{
+  if (simSerialTail == simSerialHead) return -1;
+
+  unsigned char value = simSerial[simSerialTail];
+  simSerialTail = (simSerialTail + 1) % SIM_SERIAL_SIZE;
+  return value;
+}
+
+//Takes all bytes at once, the host has no transmit buffer limit
+unsigned int halSerialWrite(const unsigned char *data, unsigned int length)
+{
+  if (length >= 2 && data[0] == FRAME_SYNC && data[1] == simWait) simWait = -1;
+  simChanged = 1;
+
+  if (!simQuiet)
+  {
+    printf("%8lu serial ", simMicros / 1000);
+    for (unsigned int i = 0; i < length; i++) printf("%02X", data[i]);
+    printf("\n");
+  }
+  return length;
+}
+
+
+//==================== EEPROM ====================
+
+void halEepromRead(unsigned int address, void *data, unsigned int length)
+{
+  if (simBooting && !simBootRead)
+  {
+    simBootRead = 1;
+    simBootStart = simMicros;
+  }
+
+  simEepromReads += length;
+  simMicros += length * SIM_EEPROM_READ;
+
+  for (unsigned int i = 0; i < length; i++)
+    ((unsigned char *)data)[i] = simEeprom[(address + i) % SIM_EEPROM_SIZE];
+}
+
+void halEepromWrite(unsigned int address, const void *data, unsigned int length)
+{
+  for (unsigned int i = 0; i < length; i++)
+  {
+    unsigned char value = ((const unsigned char *)data)[i];
+    unsigned int cell = (address + i) % SIM_EEPROM_SIZE;
+
+    // Update semantics, unchanged cells are not written
+    if (simEeprom[cell] == value) continue;
+
+    simEeprom[cell] = value;
+    simCellWrites[cell]++;
+    simStats.eepromWrites++;
+    simWrites++;
+    simChanged = 1;
+    simMicros += SIM_EEPROM_WRITE;
+
+    // Cut after this write, the run goes on as if the power had stayed
+    if (simCutEvery != 0 && simWrites % simCutEvery == 0) simCutSend(SIM_CUT_WRITE, cell);
+  }
+}
+
+
+//==================== RFID Reader ====================
+
+void halReaderBegin()
+{
+}
+
+//WUPA: answered by ATQA, or the poll timeout runs out
+bool halReaderWakeup(unsigned char reader)
+{
+  simReaderActive = reader;
+  simStats.wakeups++;
+  if (simTag[reader].present) simReader(SIM_SPI_TIMEOUT + SIM_SPI_TRANSCEIVE, 1, 0);
+  else simReader(SIM_SPI_TIMEOUT + SIM_SPI_TRANSCEIVE, 0, SIM_POLL_TIMEOUT);
+
+  return simTag[reader].present;
+}
+
+//HLTA: success means the Tag stays silent until the poll timeout
+void halReaderHalt(unsigned char reader)
+{
+  simReaderActive = reader;
+  simReader(SIM_SPI_CRC + SIM_SPI_TRANSCEIVE, 0, SIM_POLL_TIMEOUT);
+}
+
+//Anticollision and select per cascade level (one level per 3 or 4 UID bytes)
+bool halReaderSelect(unsigned char reader, tagUID_t *UID)
+{
+  simTag_t *tag = &simTag[reader];
+
+  simReaderActive = reader;
+  if (!tag->present) return 0;
+
+  simStats.selects++;
+  unsigned int levels = tag->UID.size == 4 ? 1 : tag->UID.size == 7 ? 2 : 3;
+  simReader(SIM_SPI_TIMEOUT + levels * (2 * SIM_SPI_TRANSCEIVE + SIM_SPI_CRC), 2 * levels, 0);
+
+  *UID = tag->UID;
+  return 1;
+}
+
+//Authenticate and MIFARE_Read, Master Tags carry SIM_MASTER_BLOCK in block 2, all other blocks read as zero
+bool halReaderReadBlock(unsigned char reader, unsigned char block, unsigned char *data)
+{
+  simReaderActive = reader;
+  if (!simTag[reader].present) return 0;
+
+  simStats.blockReads++;
+  simReader(2 * SIM_SPI_TRANSCEIVE + 2 * SIM_SPI_CRC, 3, 0);
+
+  memset(data, 0, 16);
+  if (simTag[reader].master && block == 2) memcpy(data, SIM_MASTER_BLOCK, 16);
+  return 1;
+}
+
+void halReaderRelease(unsigned char reader)
+{
+  simReader(SIM_SPI_TIMEOUT + SIM_SPI_STOPCRYPTO, 0, 0);
+  halReaderHalt(reader);
+}
+
+#endif /* ARDUINO */
@@ -0,0 +1,91 @@
+//==================== Includes ====================
+
+#include "ledAnim.h"
+
+#if LED_BRIGHTNESS > 255
+#error "LED_BRIGHTNESS is an 8 bit LED value"
+#endif
+
+//==================== Defines ====================
+
+/*Table entries, four at a time up to all 256*/
+#define LED_LEVELS4(i) ledLevel(i), ledLevel(i + 1), ledLevel(i + 2), ledLevel(i + 3)
+#define LED_LEVELS16(i) LED_LEVELS4(i), LED_LEVELS4(i + 4), LED_LEVELS4(i + 8), LED_LEVELS4(i + 12)
+#define LED_LEVELS64(i) LED_LEVELS16(i), LED_LEVELS16(i + 16), LED_LEVELS16(i + 32), LED_LEVELS16(i + 48)
+
+//==================== Function Prototypes ====================
+
+unsigned char ledLerp(unsigned char from, unsigned char to, unsigned char phase);
+
+//LED value of a perceived level: gamma 2 scaled to LED_BRIGHTNESS, rounded
+constexpr uint8_t ledLevel(unsigned long level)
+{
+  return (level * level * LED_BRIGHTNESS + 255UL * 255 / 2) / (255UL * 255);
+}
+
+//==================== Global Variables ====================
+
+/*Gamma and brightness table*/
+constexpr uint8_t ledLevels[256] PROGMEM = {
+  LED_LEVELS64(0), LED_LEVELS64(64), LED_LEVELS64(128), LED_LEVELS64(192)};
+
+
+//==================== LED Functions ====================
+
+//Maps a color of perceived levels to LED values
+RGBW ledColor(RGBW color)
+{
+  color.g = pgm_read_byte(&ledLevels[color.g]);
+  color.r = pgm_read_byte(&ledLevels[color.r]);
+  color.b = pgm_read_byte(&ledLevels[color.b]);
+  color.w = pgm_read_byte(&ledLevels[color.w]);
+  return color;
+}
+
+//Starts an animation at its first keyframe, faded to from the last one
+void ledAnimStart(ledAnim_t *anim, const ledAnimation_t *animation, unsigned long now)
+{
+  ledKeyframe_t last;
+
+  anim->frames = animation->frames;
+  anim->length = animation->length;
+  anim->index = 0;
+  anim->start = now;
+
+  memcpy_P(&last, &anim->frames[anim->length - 1], sizeof(last));
+  anim->from = last.color;
+}
+
+//Returns the color of the animation at now, in perceived levels
+RGBW ledAnimFrame(ledAnim_t *anim, unsigned long now)
+{
+  ledKeyframe_t frame;
+  memcpy_P(&frame, &anim->frames[anim->index], sizeof(frame));
+
+  //Catch up on all keyframes that passed since the last frame
+  while(now - anim->start >= frame.duration)
+  {
+    anim->start += frame.duration;
+    anim->from = frame.color;
+    if(++anim->index >= anim->length) anim->index = 0;
+
+    memcpy_P(&frame, &anim->frames[anim->index], sizeof(frame));
+  }
+
+  // Below the duration, so the product stays below 65536
+  unsigned char phase = ((uint16_t)(now - anim->start) * frame.rate) >> 8;
+
+  RGBW color;
+  color.g = ledLerp(anim->from.g, frame.color.g, phase);
+  color.r = ledLerp(anim->from.r, frame.color.r, phase);
+  color.b = ledLerp(anim->from.b, frame.color.b, phase);
+  color.w = ledLerp(anim->from.w, frame.color.w, phase);
+  return color;
+}
+
+//Returns the level phase / 256 of the way from from to to
+unsigned char ledLerp(unsigned char from, unsigned char to, unsigned char phase)
+{
+  if(to >= from) return from + (((unsigned int)(to - from) * phase) >> 8);
+  return from - (((unsigned int)(from - to) * phase) >> 8);
+}
@@ -1,31 +1,98 @@
 //==================== Includes ====================
 
-#include <Arduino.h>
-#include <EEPROM.h>
-#include <SPI.h>
-#include <MFRC522.h>
 #include <string.h>
-#include "../lib/Arduino_SK6812/SK6812.h"
+#include "hal.h"
+#include "tagUID.h"
+#include "store.h"
+#include "frame.h"
+#include "telemetry.h"
+#include "eventLog.h"
+#include "provision.h"
+#include "framTable.h"
+#include "grantCache.h"
+#include "ledAnim.h"
 
 
 //==================== Defines ====================
 
 /*Pin definition*/
-#define RST_PIN 9
-#define SS_PIN 10
-
 #define SIGNALIZER_BUZZER 14
-#define SIGNALIZER_LED 15
 #define SIGNALIZER_OPENER 17
 
+/*Door openers of further readers, see HAL_READERS; pin 18 is TXD1 of the HAL_LED_USART chain*/
+#define SIGNALIZER_OPENERS {SIGNALIZER_OPENER, 16, 18, 19}
+#define SIGNALIZER_OPENERS_COUNT 4
+
 /*How long the Lock should be open after authentication in seconds*/
 #define OPEN_TIME 3
-/*Define size of Whitelist (depends on RAM size of Controller)*/
+/*Main loop period in ms*/
+#define LOOP_TICK 10
+
+/*How long a Tag may stop answering before it counts as removed in ms*/
+#define PRESENCE_DEBOUNCE 60
+
+/*Keying times in seconds: closes without Tag, member held is removed, Master held resets the Whitelist, then everything*/
+#define KEYING_TIMEOUT 10
+#define KEYING_REMOVE_TIME 5
+#define KEYING_RESET_WHITELIST_TIME 10
+#define KEYING_RESET_MASTER_TIME 13
+
+/*Buzzer frequency in Hz*/
+#define BUZZER_FREQUENCY 3000
+
+/*Define size of Whitelist (depends on RAM size of Controller), build flags may override.
+  Built with WHITELIST_FRAM the Whitelist is kept on an external SPI FRAM instead, see framTable.h.
+  Built with WHITELIST_INDEX the hash table only keeps the store slot of each member, see whitelistEntry_t*/
+#ifndef WHITELIST_SIZE
+#ifdef WHITELIST_FRAM
+#define WHITELIST_SIZE 8000
+#else
 #define WHITELIST_SIZE 100
-
-#define ADDRESS_WHITELIST 0x020
-#define ADDRESS_WHITELISTCOUNT 0x005
+#endif
+#endif
+/*Slots of the Whitelist hash table (power of two, keep ~20% above WHITELIST_SIZE)*/
+#ifndef WHITELIST_SLOTS_BITS
+#define WHITELIST_SLOTS_BITS 7
+#endif
+#define WHITELIST_SLOTS (1 << WHITELIST_SLOTS_BITS)
+
+/*Bits of the Bloom filter in front of the hash table (power of two) and bits set per key*/
+#ifndef WHITELIST_BLOOM_BITS
+#define WHITELIST_BLOOM_BITS 10
+#endif
+#define WHITELIST_BLOOM_SIZE (1 << WHITELIST_BLOOM_BITS)
+#define WHITELIST_BLOOM_HASHES 3
+
+/*Value of an empty slot of the Whitelist hash table*/
+#define WHITELIST_EMPTY 0x00000000
+
+/*Fixed-address layout used before the store, only read for conversion: Master and a list of 4 byte UIDs*/
 #define ADDRESS_MASTER 0x010
+#define ADDRESS_WHITELIST_LEGACY 0x020
+#define LEGACY_SIZE 100
+#define LEGACY_ERASED 0xFFFFFFFF
+/*First store slot behind the list, and the first list entry converted into the slots below*/
+#define LEGACY_FIRST_SLOT ((ADDRESS_WHITELIST_LEGACY + LEGACY_SIZE * 4 - STORE_BEGIN + STORE_SLOT_SIZE - 1) / STORE_SLOT_SIZE)
+#define LEGACY_LOWER_ENTRY (STORE_SLOTS - LEGACY_FIRST_SLOT - 1)
+
+#if !defined(WHITELIST_FRAM) && WHITELIST_SIZE + 1 + STORE_RESERVE > STORE_SLOTS
+#error "Store too small: needs a slot per member, one for the Master and the reserve"
+#endif
+#if LEGACY_SIZE - LEGACY_LOWER_ENTRY >= (ADDRESS_WHITELIST_LEGACY + LEGACY_LOWER_ENTRY * 4 - STORE_BEGIN) / STORE_SLOT_SIZE
+#error "Conversion would write the lower store slots over list entries it has not read yet"
+#endif
+#if HAL_READERS > SIGNALIZER_OPENERS_COUNT
+#error "More readers than door openers"
+#endif
+#if defined(HAL_LED_USART) && HAL_READERS >= 3
+#error "HAL_LED_USART sends the LED chain on pin 18, the door opener of the third reader"
+#endif
+#if defined(WHITELIST_FRAM) && defined(WHITELIST_INDEX)
+#error "WHITELIST_FRAM and WHITELIST_INDEX exclude each other"
+#endif
+#if defined(WHITELIST_FRAM) && WHITELIST_SIZE > FRAM_TABLE_ENTRIES * 4 / 5
+#error "FRAM table too small: keep it at most 80% full"
+#endif
 
 //==================== Objects ====================
 
@@ -39,73 +106,273 @@ typedef struct
   bool old;
 } edge_t;
 
+/*struct for debounced Tag presence*/
 typedef struct
 {
-  unsigned char loopcounter;
-  unsigned char pulse;
-} timer_t;
+  bool present;
+  unsigned long lastSeen;   // Last poll the Tag answered
+  unsigned long lastAbsent; // Last poll without answer
+  unsigned long latency;    // Upper bound from arrival to edge_pos in ms
+  tagUID_t UID;             // Taken when the Tag was selected
+} presence_t;
+
+/*struct for an output that switches itself off after a time*/
+typedef struct
+{
+  unsigned char pin;
+  bool active;
+  unsigned long start;
+  unsigned long duration;
+} timedOutput_t;
 
 /*enum for states*/
-enum states_t {noMaster, idle, keying};
+enum states_t {noMaster, idle, keying, statesCount};
+
+/*enum for what a poll saw of the Tag, the first four are act << 1 | old of the edge trigger*/
+enum tagEvent_t {tagAbsent, tagLeave, tagArrive, tagHold, tagTimeout, tagEventsCount};
+
+/*enum for signal LED colors*/
+enum signalColor_t {colorKeep, colorOff, colorRed, colorGreen};
 
-/*Classes*/
-SK6812 LED(1);                    // Numbers of LEDs in LED chain
-MFRC522 mfrc522(SS_PIN, RST_PIN); // Create MFRC522 instance
+/*struct for one step of a signal pattern*/
+typedef struct
+{
+  bool buzzer;             // Buzzer on during this step
+  signalColor_t color;     // LED color applied at the start of this step
+  unsigned int duration;   // Step length in ms
+} signalStep_t;
+
+/*struct for the signal pattern player of a reader, the buzzer is shared*/
+typedef struct
+{
+  const signalStep_t *steps;
+  unsigned char length;
+  unsigned char index;
+  unsigned long start;
+  unsigned char pixel;     // LED pixel of the reader
+  bool buzzer;             // Current step wants the buzzer on
+} signalPlayer_t;
+
+/*struct for one reader and the door it opens*/
+typedef struct
+{
+  unsigned char index;
+  states_t state;
 
-/*Colors*/
-RGBW color_red = {100, 0, 0, 0}; // Values from 0-255
-RGBW color_green = {0, 100, 0, 0};
+  presence_t presence;
+  edge_t RfidPresent;
+  tagUID_t TagUID;          // Kept until the Tag left
+  bool isMaster;
+
+  //keying, times in seconds counted from halMillis()
+  uint8_t keyingPresentTime;
+  unsigned long keyingPresentStart;
+  unsigned long keyingLastSeen;
+  bool openkeying;
+
+  //flags
+  bool keyingResetWhitelist;
+  bool keyingResetMaster;
+
+  timedOutput_t opener;
+  signalPlayer_t signal;
+  ledAnim_t glow;           // Animation of the state, shown while no signal plays
+} reader_t;
+
+#ifdef WHITELIST_INDEX
+/*Whitelist hash table entry: store slot + 1 of the member's ADD record, lookups read the UID from EEPROM*/
+typedef unsigned char whitelistEntry_t;
+#else
+/*Whitelist hash table entry: uidKey() of the member*/
+typedef unsigned long whitelistEntry_t;
+#endif
+
+/*Colors in perceived levels from 0-255, LED_BRIGHTNESS gives the LED value of 255;
+  the strip takes red in the first field of RGBW, the one the library calls g*/
+RGBW color_red = {255, 0, 0, 0};
+RGBW color_green = {0, 255, 0, 0};
 RGBW color_off = {0, 0, 0, 0};
 
+/*State animations (LED color, fade to it in ms): no Master pulses red, keying breathes green*/
+const ledKeyframe_t glowNoMaster[] PROGMEM = {
+  LED_KEYFRAME(255, 0, 0, 0, 150), LED_KEYFRAME(255, 0, 0, 0, 150),
+  LED_KEYFRAME(0, 0, 0, 0, 300), LED_KEYFRAME(0, 0, 0, 0, 1400)};
+
+const ledKeyframe_t glowIdle[] PROGMEM = {
+  LED_KEYFRAME(0, 0, 0, 0, 1000)};
+
+const ledKeyframe_t glowKeying[] PROGMEM = {
+  LED_KEYFRAME(0, 255, 0, 0, 1000), LED_KEYFRAME(0, 60, 0, 0, 1000)};
+
+/*Signal patterns (buzzer, LED color, duration in ms)*/
+const signalStep_t patternPositive[] PROGMEM = {
+  {1, colorGreen, 150}, {0, colorOff, 0}};
+
+const signalStep_t patternPositiveSound[] PROGMEM = {
+  {1, colorKeep, 150}, {0, colorOff, 0}};
+
+const signalStep_t patternRemovedMember[] PROGMEM = {
+  {1, colorOff, 120}, {0, colorKeep, 120},
+  {1, colorOff, 120}, {0, colorKeep, 120},
+  {1, colorOff, 120}, {0, colorKeep, 120}};
+
+const signalStep_t patternWhitelistFull[] PROGMEM = {
+  {1, colorRed, 120}, {0, colorOff, 120},
+  {1, colorRed, 120}, {0, colorOff, 120},
+  {1, colorRed, 120}, {0, colorOff, 120},
+  {1, colorRed, 120}, {0, colorOff, 120},
+  {1, colorRed, 120}, {0, colorOff, 120},
+  {1, colorRed, 120}, {0, colorOff, 120},
+  {1, colorRed, 120}, {0, colorOff, 120},
+  {1, colorRed, 120}, {0, colorOff, 120}};
+
+const signalStep_t patternEndKeying[] PROGMEM = {
+  {1, colorKeep, 700}, {0, colorKeep, 0}};
+
+const signalStep_t patternPermDenied[] PROGMEM = {
+  {1, colorRed, 120}, {0, colorOff, 120},
+  {1, colorRed, 120}, {0, colorOff, 120},
+  {1, colorRed, 120}, {0, colorOff, 120},
+  {1, colorRed, 120}, {0, colorOff, 120}};
+
+const signalStep_t patternReject[] PROGMEM = {
+  {1, colorOff, 350}, {1, colorRed, 150}, {0, colorOff, 0}};
+
+const signalStep_t patternClose[] PROGMEM = {
+  {1, colorKeep, 1000}, {0, colorKeep, 0}};
+
+const signalStep_t patternResetWhitelist[] PROGMEM = {
+  {1, colorOff, 500}, {0, colorKeep, 120}, {1, colorKeep, 150}, {0, colorKeep, 0}};
+
+const signalStep_t patternFullReset[] PROGMEM = {
+  {1, colorOff, 120}, {0, colorKeep, 120},
+  {1, colorOff, 120}, {0, colorKeep, 1620},
+  {0, colorGreen, 800}, {0, colorOff, 0}};
+
+/*State machine action, returns the next state*/
+typedef states_t (*readerAction_t)(reader_t *reader, unsigned long now);
+
+/*Table entry, without a default constructor an entry left out of the table does not compile*/
+struct readerTransition_t
+{
+  readerAction_t action;
+  constexpr readerTransition_t(readerAction_t action) : action(action) {}
+};
+
+/*Starts a pattern on a reader, replacing the one currently playing*/
+#define SIGNAL_START(reader, pattern) signalStart(&(reader)->signal, pattern, sizeof(pattern) / sizeof(signalStep_t))
+
 //==================== Function Prototypes ====================
 
 // Signalisation Functions
-void SignalPositive();
-void SignalPositiveSound();
-void SignalRemovedMember();
-void SignalWhitelistFull();
-void SignalEndKeying();
-void SignalResetWhitelist();
-void SignalPermDenied();
-void SignalReject();
-void SignalClose();
-void SignalFullReset();
+void SignalPositive(reader_t *reader);
+void SignalPositiveSound(reader_t *reader);
+void SignalRemovedMember(reader_t *reader);
+void SignalWhitelistFull(reader_t *reader);
+void SignalEndKeying(reader_t *reader);
+void SignalResetWhitelist(reader_t *reader);
+void SignalPermDenied(reader_t *reader);
+void SignalReject(reader_t *reader);
+void SignalClose(reader_t *reader);
+void SignalFullReset(reader_t *reader);
+
+// Signal Player Functions
+void signalStart(signalPlayer_t *player, const signalStep_t *steps, unsigned char length);
+void signalUpdate(signalPlayer_t *player);
+bool signalBusy(const signalPlayer_t *player);
+void signalApply(signalPlayer_t *player, const signalStep_t *step);
+void signalBuzzer(signalPlayer_t *player, bool on);
+void ledShow(unsigned char pixel, RGBW color);
+void readerGlow(reader_t *reader, unsigned long now);
+
+// Timed Output Functions
+void outputTrigger(timedOutput_t *output, unsigned long duration);
+void outputUpdate(timedOutput_t *output);
 
 // Program Logic Functions
-bool tagPresent();
-bool checkMaster();
-unsigned long getUID();
+void readerUpdate(reader_t *reader, unsigned long now);
+reader_t *readerKeying();
+bool tagPresent(reader_t *reader);
+bool readTag(reader_t *reader);
+
+// State Machine Functions
+states_t readerStay(reader_t *reader, unsigned long now);
+states_t noMasterPresent(reader_t *reader, unsigned long now);
+states_t idleArrive(reader_t *reader, unsigned long now);
+states_t keyingArrive(reader_t *reader, unsigned long now);
+states_t keyingHold(reader_t *reader, unsigned long now);
+states_t keyingLeave(reader_t *reader, unsigned long now);
+states_t keyingAbsent(reader_t *reader, unsigned long now);
+states_t keyingExpire(reader_t *reader, unsigned long now);
+
 
 // Whitelist Functions
-void whitelistRemove(unsigned long UID);
-void whitelistAdd(unsigned long UID);
+bool whitelistRemove(const tagUID_t *UID);
+bool whitelistAdd(const tagUID_t *UID);
 void whitelistReset();
-bool isWhitelistMember(unsigned long UID);
+bool isWhitelistMember(const tagUID_t *UID);
+bool isWhitelistGranted(const tagUID_t *UID);
+bool whitelistHolds(const tagUID_t *UID);
+unsigned int whitelistHome(unsigned long key);
+unsigned int whitelistFind(const tagUID_t *UID);
+bool whitelistMatch(unsigned int slot, const tagUID_t *UID, unsigned long key);
+unsigned long whitelistKeyAt(unsigned int slot);
+bool whitelistInsert(const tagUID_t *UID);
+bool whitelistPut(const tagUID_t *UID, whitelistEntry_t entry);
+void whitelistIndexSet(const tagUID_t *UID, unsigned char storeSlot);
+bool whitelistDelete(const tagUID_t *UID);
+void whitelistClear();
+bool whitelistLongAt(unsigned int slot);
+void whitelistLongSet(unsigned int slot, bool isLong);
+bool whitelistPersist(unsigned char op, const tagUID_t *UID);
+unsigned int whitelistBloomBit(unsigned long key, unsigned char hash);
+void whitelistBloomAdd(unsigned long key);
+bool whitelistBloomMay(unsigned long key);
+void whitelistBloomRebuild();
 
 //Master functions
-void masterSet(unsigned long UID);
+void masterSet(const tagUID_t *UID);
 void masterReset();
 
+//Check Functions
+const char *invariantCheck(bool store);
+unsigned long stateDigest();
+
 //==================== Global Variables ====================
 
 /*RFID reading variables*/
-int blockNum = 2;
-byte blockData[16] = {"MasterMediumCard"};
+byte blockNum = 2;
+byte blockData[16] = {'M','a','s','t','e','r','M','e','d','i','u','m','C','a','r','d'};
  
-MFRC522::StatusCode status;
-MFRC522::MIFARE_Key key;
 
-/*Flags*/
-bool repeatFlagPresent = 0;
+/*Action per state and Tag event*/
+constexpr readerTransition_t readerTransitions[statesCount][tagEventsCount] PROGMEM = {
+  //             tagAbsent     tagLeave       tagArrive        tagHold          tagTimeout
+  /*noMaster*/  {readerStay,   readerStay,    noMasterPresent, noMasterPresent, readerStay},
+  /*idle*/      {readerStay,   readerStay,    idleArrive,      readerStay,      readerStay},
+  /*keying*/    {keyingAbsent, keyingLeave,   keyingArrive,    keyingHold,      keyingExpire}};
+
+/*Animation per state*/
+const ledAnimation_t stateGlows[statesCount] PROGMEM = {
+  LED_ANIMATION(glowNoMaster), LED_ANIMATION(glowIdle), LED_ANIMATION(glowKeying)};
+
+/*Readers, their doors and signals*/
+reader_t readers[HAL_READERS] = {0};
+const unsigned char readerOpeners[SIGNALIZER_OPENERS_COUNT] = SIGNALIZER_OPENERS;
 
 /*UID*/
-unsigned long TagUID = 0;
-unsigned long whitelist[WHITELIST_SIZE] = {0};
-unsigned char whitelistMemberCount = 0;
-unsigned long registeredMaster = 0;
+#ifdef WHITELIST_FRAM
+bool whitelistMigrating = 0;                              // FRAM table was just formatted, take the stored Whitelist
+#else
+whitelistEntry_t whitelist[WHITELIST_SLOTS] = {0};
+unsigned char whitelistLong[WHITELIST_SLOTS / 8] = {0};   // Bit per slot, set for UIDs longer than 4 bytes
+unsigned char whitelistBloom[WHITELIST_BLOOM_SIZE / 8] = {0};
+unsigned char whitelistLongCount = 0;
+#endif
+unsigned int whitelistMemberCount = 0;
+tagUID_t registeredMaster = {0};
 
-byte bufferLen = 18;
-byte readBlockData[18];
+byte readBlockData[16];
 
 
 //==================== Setup ====================
@@ -113,669 +380,1161 @@ byte readBlockData[18];
 void setup()
 {
   /*Initialisation*/
-  Serial.begin(9600);
-  SPI.begin();        // Initiate  SPI bus
-  mfrc522.PCD_Init(); // Initiate MFRC522
+  halRamMark();
+  halSerialBegin();
+  halReaderBegin();
+  halTickBegin(LOOP_TICK);
 
   /*Pin Initialisation*/
-  pinMode(SIGNALIZER_BUZZER, OUTPUT);
-  pinMode(SIGNALIZER_LED, OUTPUT);
-  pinMode(SIGNALIZER_OPENER, OUTPUT);
-  LED.set_output(SIGNALIZER_LED); // Digital Pin
+  halPinOutput(SIGNALIZER_BUZZER);
+  halLedBegin();
+
+  for (unsigned char r = 0; r < HAL_READERS; r++)
+  {
+    readers[r].index = r;
+    readers[r].opener.pin = readerOpeners[r];
+    readers[r].signal.pixel = r;
+    halPinOutput(readers[r].opener.pin);
+  }
 
   /*Signalisation setup*/
-  delay(100);
-  LED.set_rgbw(0, color_off);
-  LED.sync();
-  noTone(SIGNALIZER_BUZZER);
+  for (byte i = 0; i < 100 / LOOP_TICK; i++)
+    halTickWait();
+  for (unsigned char r = 0; r < HAL_READERS; r++)
+    ledShow(r, color_off);
+  halNoTone(SIGNALIZER_BUZZER);
 
 
   //-------- EEPROM --------
-  
-  //Get Whitelist 
-  EEPROM.get(ADDRESS_WHITELIST, whitelist);
 
-  for(uint8_t loop = 0; loop < WHITELIST_SIZE; loop++)
+  unsigned long bootStart = telemetryStart();
+
+#ifdef WHITELIST_FRAM
+  //Whitelist lives on the FRAM, a chip without table is filled from the store once
+  halFramBegin();
+  whitelistMigrating = !framTableBegin();
+  if(whitelistMigrating) framTableFormat();
+  whitelistMemberCount = framTableCount();
+#endif
+
+  //No store yet, move the fixed-address layout over once
+  if(!storeBegin())
   {
-    if(whitelist[loop] == 0xFFFFFFFF) whitelist[loop] = 0;
+    storeConvert(LEGACY_FIRST_SLOT);
+    storeBegin();
+#ifdef WHITELIST_FRAM
+    whitelistMigrating = 1;
+#endif
   }
 
+  //Rebuild Master and Whitelist from the store
+  storeReplay();
+#ifdef WHITELIST_FRAM
+  if(whitelistMigrating) framTableCommit();
+  whitelistMigrating = 0;
+#endif
 
-  //get whitelistcount
-  EEPROM.get(ADDRESS_WHITELISTCOUNT, whitelistMemberCount);
-  if(registeredMaster == 0xFF) registeredMaster = 0;
+  //Without Master the Whitelist is not used
+  if(registeredMaster.size == 0 && whitelistMemberCount != 0) whitelistReset();
 
+  telemetryBoot(bootStart, whitelistMemberCount);
+}
 
-  //Get Master
-  EEPROM.get(ADDRESS_MASTER, registeredMaster);
-  if(registeredMaster == 0xFFFFFFFF) registeredMaster = 0;
+//==================== Loop ====================
 
-  if(registeredMaster == 0)
+void loop()
+{
+  unsigned char first = 0;
+
+  while(1)
   {
-    for(uint8_t loop = 0; loop < WHITELIST_SIZE; loop++)
+    //----------Readers
+
+    //One poll per reader and tick, the reader served first moves on each tick
+    unsigned long now = halMillis();
+
+    for (unsigned char i = 0; i < HAL_READERS; i++)
+      readerUpdate(&readers[(first + i) % HAL_READERS], now);
+    first = (first + 1) % HAL_READERS;
+
+    //----------Outputs
+
+    for (unsigned char r = 0; r < HAL_READERS; r++)
     {
-      whitelist[loop] = 0;
+      signalUpdate(&readers[r].signal);
+      readerGlow(&readers[r], now);
+      outputUpdate(&readers[r].opener);
     }
 
-    whitelist[WHITELIST_SIZE] = 0;
-  }  
-}
+    //----------Serial
 
-//==================== Loop ====================
+    //Single request bytes between frames, provisioning frames keep keying open
+    reader_t *keyingReader = readerKeying();
+    int received;
+    while((received = halSerialRead()) >= 0)
+    {
+      if(!frameReceiving() && received == TELEMETRY_REQUEST) telemetryDump();
+      else if(!frameReceiving() && received == TELEMETRY_STATUS_REQUEST) telemetryStatus();
+      else if(frameReceive(received) && provisionFrame(keyingReader != 0)) keyingReader->keyingLastSeen = now;
+    }
+    provisionUpdate();
+    telemetryUpdate();
+    eventLogUpdate();
+    frameUpdate();
 
-void loop()
+    //----------Wait for next tick
+
+    halTickWait();
+  }
+}
+
+//Polls one reader and runs the state machine of its door
+void readerUpdate(reader_t *reader, unsigned long now)
 {
-  //----------Local Declarations  
-  edge_t RfidPresent = {0};
-  timer_t time = {0};
-  states_t state = noMaster;
+  //----------Header
 
-  unsigned long wasPresent = 0;
-  bool wasPresentMaster = 0;
-  bool isMaster = 0;
+  //Master set or reset at another reader
+  if(registeredMaster.size == 0) reader->state = noMaster;
+  else if(reader->state == noMaster) reader->state = idle;
 
-  //keying
-  uint8_t keyingPresentTime = 0;
-  uint8_t keyingTimeout = 0;
-  bool openkeying = 0;
+  // edge trigger setup
+  unsigned long probe = telemetryStart();
+  reader->RfidPresent.act = tagPresent(reader);
 
-  //flags
-  bool keyingResetWhitelist = 0;
-  bool keyingResetMaster = 0;
-  
-  //If Master registered, go to idle state
-  if(registeredMaster != 0) state = idle;
+  // Only polls that see a Tag arrive or leave, idle polls would flood the ring
+  if(reader->RfidPresent.act != reader->RfidPresent.old) telemetryStop(TELEMETRY_TAG_PRESENT, probe);
+  reader->RfidPresent.edge = reader->RfidPresent.act ^ reader->RfidPresent.old;
+  reader->RfidPresent.edge_pos = reader->RfidPresent.edge & reader->RfidPresent.act;
+  reader->RfidPresent.edge_neg = reader->RfidPresent.edge & reader->RfidPresent.old;
 
-  while(1)
+
+  //Tag Information, read once per presence and kept until the Tag leaves
+  if(reader->RfidPresent.edge_pos)
   {
-    //----------Loop Header
+    probe = telemetryStart();
+    reader->isMaster = readTag(reader);
+    telemetryStop(TELEMETRY_READ_TAG, probe);
+  }
 
-    // edge trigger setup
-    RfidPresent.act = tagPresent();
-    RfidPresent.edge = RfidPresent.act ^ RfidPresent.old;
-    RfidPresent.edge_pos = RfidPresent.edge & RfidPresent.act;
-    RfidPresent.edge_neg = RfidPresent.edge & RfidPresent.old;
 
+  //keying variables
+  if(reader->state != keying)
+  {
+    reader->keyingPresentTime = 0;
+    reader->keyingPresentStart = now;
+    reader->keyingLastSeen = now;
+    reader->openkeying = 0;
+  }
 
-    //Tag Information
-    isMaster = checkMaster();
-    if(RfidPresent.edge_pos) TagUID = getUID();
-    
-    if(isMaster) wasPresentMaster = 1;
-    if(RfidPresent.edge_neg) wasPresent = TagUID;
+  //----------Decision
 
+  //Poll outcome as event, an empty field turns into a timeout once keying saw nothing for KEYING_TIMEOUT s
+  tagEvent_t event = (tagEvent_t)(reader->RfidPresent.act << 1 | reader->RfidPresent.old);
+  if(event == tagAbsent && now - reader->keyingLastSeen >= KEYING_TIMEOUT * 1000UL) event = tagTimeout;
 
-    //keying variables
-    if(state != keying)
-    {
-      keyingPresentTime = 0;
-      keyingTimeout = 0;
-      openkeying = 0;
-    }
+  readerAction_t action;
+  memcpy_P(&action, &readerTransitions[reader->state][event].action, sizeof(action));
+  reader->state = action(reader, now);
 
-    for (byte i = 0; i < 6; i++)
-      key.keyByte[i] = 0xFF;
 
-    //----------Loop Main
-    
-    switch (state)
-    {
-//==================== noMaster
+  //----------Footer
 
-      case noMaster:
-      //Don't register Master, if Reset was executed
-      if(keyingResetMaster)
-      {
-        if(RfidPresent.edge_neg) keyingResetMaster = 0;
-      }
-      else
-      {
-        //Register Master if Master is presented
-        if(RfidPresent.act && isMaster)
-        {
-          LED.set_rgbw(0, color_green);
-          LED.sync();
-          masterSet(TagUID);        
-          
-          openkeying = 1;
-          state = keying;
-        }
-        break;
-      }
-        
-//==================== Idle
-
-      case idle:
-        if(RfidPresent.edge_pos)
-        {
-          Serial.println(TagUID);
-          if(isMaster)
-          {
-            //Go to keying state, if registered Master is presented
-            if(TagUID == registeredMaster)
-            {
-              openkeying = 1;
-              state = keying;
-            }
-            else
-            {
-              //Presented not registered Master
-              SignalReject();
-            }
-          }
-          //is User
-          else
-          {
-            if(isWhitelistMember(TagUID))
-            {
-              //Access Granted
-              digitalWrite(SIGNALIZER_OPENER, HIGH);
-              SignalPositive();
-              delay(OPEN_TIME * 1000);
-              digitalWrite(SIGNALIZER_OPENER, LOW);
-            }
-            //Access Denied
-            else if(TagUID != 0) SignalPermDenied();
-          }
-        }
-        break;
-
-//==================== Keying
-
-      case keying:
-      if(RfidPresent.edge_pos)
-      {
-        //Not registered Master presented
-        if(isMaster && TagUID != registeredMaster)
-        {
-          SignalEndKeying();
-          keyingTimeout = 0;
-          keyingPresentTime = 0;
-          state = idle;
-        }
-      }
+  //Reset Values
+  reader->RfidPresent.old = reader->RfidPresent.act;
+  if(reader->RfidPresent.edge_neg) 
+  {
+    reader->isMaster = 0;
+    uidClear(&reader->TagUID);
 
-        if(RfidPresent.act)
-        {
-          //Reset timeout
-          keyingTimeout = 0;
-          
-          //Count present time
-          if(time.pulse) keyingPresentTime++;
-
-          //Light up signalization LED
-          if(isMaster == 0 || (isMaster && TagUID == registeredMaster))
-          {
-            LED.set_rgbw(0, color_green);
-            LED.sync();
-          }
-
-          //Remove if user is presented 5 seconds
-          if(keyingPresentTime == 5 && isMaster == 0 && isWhitelistMember(TagUID))
-          {
-            Serial.println("Removed");
-            SignalRemovedMember();
-            whitelistRemove(TagUID);
-          }
-
-          if(isMaster)
-          {
-            //Master held longer than 10 seconds, reset Whitelist
-            if(keyingPresentTime == 10 && keyingResetWhitelist == 0) 
-            {
-              keyingResetWhitelist = 1;
-
-              delay(5);
-              LED.set_rgbw(0, color_off);
-              LED.sync();
-              SignalResetWhitelist();
-              
-              whitelistReset();
-            }
-            //Master held longer than 15 seconds, reset Master + Whitelist
-            if(keyingPresentTime == 13 && keyingResetMaster == 0)
-            {
-              keyingResetMaster = 1;
-              SignalFullReset();
-              whitelistReset();
-              masterReset();
-
-              state = noMaster;
-            }
-          }
-        }
-        else
-        {
-          //Timout handler
-          if(time.pulse) 
-          {
-            keyingTimeout++;
-
-            if(keyingTimeout >= 10)
-            {
-              keyingTimeout = 0;
-              SignalEndKeying();
-              state = idle;
-            }
-          }
-        }
-
-
-        //Card is not rpesented anymore
-        if(RfidPresent.edge_neg && keyingResetMaster == 0)
-        {
-          isMaster = checkMaster();
-          if(isMaster) wasPresentMaster = 1;
-          keyingResetWhitelist = 0;
-          keyingTimeout = 0;
-          delay(100);
-
-          LED.set_rgbw(0, color_off);
-          LED.sync();
-
-          if(wasPresentMaster)
-          {
-            if(keyingPresentTime < 10)
-            {
-              //Master was presented, opening keying process
-              if(openkeying) SignalPositive();
-              else
-              {
-                //Master presented, closing Keying process
-                SignalEndKeying();
-                state = idle;
-              }
-            }
-            
-          }
-          else
-          {
-            if(keyingPresentTime >= 5) {}
-            else
-            {
-              //Add User to Whitelist
-              if(whitelistMemberCount < WHITELIST_SIZE)
-              {
-                SignalPositiveSound();
-                whitelistAdd(wasPresent);
-              }
-              else 
-              {
-                //Whitelist is full, reject adding user to Whitelist
-                SignalWhitelistFull();
-              }
-            }
-          }
-          
-          keyingTimeout = 0;
-          openkeying = 0;
-          keyingPresentTime = 0;
-          time.loopcounter = 0;
-        }
-      break;
+    // Here and not in keying, another reader may have moved this one on while the Tag was held
+    reader->keyingResetWhitelist = 0;
+    reader->keyingResetMaster = 0;
+  }
+}
 
-      default:
-        break;
-    }
+//Returns a reader whose door is in keying, 0 if there is none
+reader_t *readerKeying()
+{
+  for (unsigned char r = 0; r < HAL_READERS; r++)
+    if(readers[r].state == keying) return &readers[r];
+  return 0;
+}
+
+
+//==================== State Machine Functions
+
+//Event without effect in this state
+states_t readerStay(reader_t *reader, unsigned long now)
+{
+  return reader->state;
+}
+
+//Registers a presented Master, not the one held since it reset everything
+states_t noMasterPresent(reader_t *reader, unsigned long now)
+{
+  if(reader->keyingResetMaster || !reader->isMaster) return noMaster;
+
+  ledShow(reader->index, color_green);
+  masterSet(&reader->TagUID);
+  eventLog(EVENT_MASTER_SET, reader->index, &reader->TagUID, 0);
 
-    //----------Loop Footer
+  reader->openkeying = 1;
+  return keying;
+}
 
-    //Reset Values
-    wasPresent = 0;
-    RfidPresent.old = RfidPresent.act;
-    if(RfidPresent.edge_neg) 
+//Registered Master opens keying, users are granted or denied
+states_t idleArrive(reader_t *reader, unsigned long now)
+{
+  //Time since the last poll without the Tag
+  unsigned long latency = halMillis() - reader->presence.lastAbsent;
+
+  if(reader->isMaster)
+  {
+    //Go to keying state, if registered Master is presented
+    if(uidEqual(&reader->TagUID, &registeredMaster))
     {
-      wasPresentMaster = 0;
-      TagUID = 0;
+      eventLog(EVENT_MASTER_ACCEPT, reader->index, &reader->TagUID, latency);
+      reader->openkeying = 1;
+      return keying;
     }
 
-    //----------Timer Setup
+    //Presented not registered Master
+    eventLog(EVENT_MASTER_REJECT, reader->index, &reader->TagUID, latency);
+    SignalReject(reader);
+  }
+  //Access Granted, a grant while open extends the window
+  else if(isWhitelistGranted(&reader->TagUID))
+  {
+    outputTrigger(&reader->opener, OPEN_TIME * 1000UL);
+    SignalPositive(reader);
+    eventLog(EVENT_GRANT, reader->index, &reader->TagUID, latency);
+  }
+  //Access Denied
+  else if(reader->TagUID.size != 0)
+  {
+    SignalPermDenied(reader);
+    eventLog(EVENT_DENY, reader->index, &reader->TagUID, latency);
+  }
+  return idle;
+}
+
+//A not registered Master ends keying, any other Tag is held from now on
+states_t keyingArrive(reader_t *reader, unsigned long now)
+{
+  if(reader->isMaster && !uidEqual(&reader->TagUID, &registeredMaster))
+  {
+    SignalEndKeying(reader);
+    return idle;
+  }
+  return keyingHold(reader, now);
+}
 
-    time.pulse = 0;
+//Counts the present time: a member held is removed, a Master held resets the Whitelist and then everything
+states_t keyingHold(reader_t *reader, unsigned long now)
+{
+  reader->keyingLastSeen = now;
+  reader->keyingPresentTime = (now - reader->keyingPresentStart) / 1000;
+
+  //Light up signalization LED, unless a signal is playing
+  if(!signalBusy(&reader->signal) && (!reader->isMaster || uidEqual(&reader->TagUID, &registeredMaster)))
+  {
+    ledShow(reader->index, color_green);
+  }
 
-    if (time.loopcounter++ >= 16)
+  if(!reader->isMaster)
+  {
+    if(reader->keyingPresentTime == KEYING_REMOVE_TIME && isWhitelistMember(&reader->TagUID))
     {
-      time.loopcounter = 0;
-      time.pulse = 1;
+      SignalRemovedMember(reader);
+      whitelistRemove(&reader->TagUID);
+      eventLog(EVENT_REMOVE, reader->index, &reader->TagUID, 0);
     }
+    return keying;
+  }
 
-    delay(10);
+  if(reader->keyingPresentTime == KEYING_RESET_WHITELIST_TIME && reader->keyingResetWhitelist == 0)
+  {
+    reader->keyingResetWhitelist = 1;
+    SignalResetWhitelist(reader);
+    whitelistReset();
+    eventLog(EVENT_RESET_WHITELIST, reader->index, &reader->TagUID, 0);
   }
+  if(reader->keyingPresentTime == KEYING_RESET_MASTER_TIME && reader->keyingResetMaster == 0)
+  {
+    reader->keyingResetMaster = 1;
+    SignalFullReset(reader);
+    whitelistReset();
+    masterReset();
+    eventLog(EVENT_RESET_MASTER, reader->index, &reader->TagUID, 0);
+    return noMaster;
+  }
+  return keying;
+}
+
+//A short Master tap opens or closes keying, a user presented shorter than the removal time is added
+states_t keyingLeave(reader_t *reader, unsigned long now)
+{
+  states_t next = keyingAbsent(reader, now);
+
+  ledShow(reader->index, color_off);
+
+  if(reader->isMaster)
+  {
+    if(reader->keyingPresentTime < KEYING_RESET_WHITELIST_TIME)
+    {
+      //Master was presented, opening keying process
+      if(reader->openkeying) SignalPositive(reader);
+      else
+      {
+        //Master presented, closing Keying process
+        SignalEndKeying(reader);
+        next = idle;
+      }
+    }
+  }
+  else if(reader->keyingPresentTime < KEYING_REMOVE_TIME)
+  {
+    //Add User to Whitelist, reject if Whitelist is full
+    if(whitelistAdd(&reader->TagUID))
+    {
+      SignalPositiveSound(reader);
+      eventLog(EVENT_ADD, reader->index, &reader->TagUID, 0);
+    }
+    else
+    {
+      SignalWhitelistFull(reader);
+      eventLog(EVENT_ADD_FULL, reader->index, &reader->TagUID, 0);
+    }
+  }
+
+  reader->openkeying = 0;
+  reader->keyingPresentTime = 0;
+  return next;
+}
+
+//Present time starts again with the next Tag
+states_t keyingAbsent(reader_t *reader, unsigned long now)
+{
+  reader->keyingPresentStart = now;
+  return keying;
+}
+
+//Nothing seen for KEYING_TIMEOUT s, neither Tag nor provisioning frame
+states_t keyingExpire(reader_t *reader, unsigned long now)
+{
+  SignalEndKeying(reader);
+  return idle;
 }
 
 
 //==================== Signalisation Functions
 
-void SignalPositive()
+void SignalPositive(reader_t *reader)
 {
-  tone(SIGNALIZER_BUZZER, 3000);
-  LED.set_rgbw(0, color_green);
-  LED.sync();
-  delay(150);
-  LED.set_rgbw(0, color_off);
-  LED.sync();
-  noTone(SIGNALIZER_BUZZER);
+  SIGNAL_START(reader, patternPositive);
 }
 
-void SignalPositiveSound()
+void SignalPositiveSound(reader_t *reader)
 {
-  tone(SIGNALIZER_BUZZER, 3000);
-  delay(150);
-  LED.set_rgbw(0, color_off);
-  LED.sync();
-  noTone(SIGNALIZER_BUZZER);
+  SIGNAL_START(reader, patternPositiveSound);
 }
 
-void SignalRemovedMember()
+void SignalRemovedMember(reader_t *reader)
 {
-  for (char i = 0; i < 3; i++)
-  {
-    tone(SIGNALIZER_BUZZER, 3000);
-    LED.set_rgbw(0, color_off);
-    LED.sync();
-    delay(120);
+  SIGNAL_START(reader, patternRemovedMember);
+}
 
-    noTone(SIGNALIZER_BUZZER);
-    delay(120);
-  }
+void SignalWhitelistFull(reader_t *reader)
+{
+  SIGNAL_START(reader, patternWhitelistFull);
 }
 
-void SignalWhitelistFull()
+void SignalEndKeying(reader_t *reader)
 {
-  for (char i = 0; i < 8; i++)
-  {
-    tone(SIGNALIZER_BUZZER, 3000);
-    LED.set_rgbw(0, color_red);
-    LED.sync();
-    delay(120);
+  SIGNAL_START(reader, patternEndKeying);
+}
 
-    LED.set_rgbw(0, color_off);
-    LED.sync();
-    noTone(SIGNALIZER_BUZZER);
-    delay(120);
-  }
+void SignalPermDenied(reader_t *reader)
+{
+  SIGNAL_START(reader, patternPermDenied);
 }
 
+void SignalReject(reader_t *reader)
+{
+  SIGNAL_START(reader, patternReject);
+}
+
+void SignalClose(reader_t *reader)
+{
+  SIGNAL_START(reader, patternClose);
+}
 
-void SignalEndKeying()
+void SignalResetWhitelist(reader_t *reader)
 {
-  tone(SIGNALIZER_BUZZER, 3000);
-  delay(700);
-  noTone(SIGNALIZER_BUZZER);
+  SIGNAL_START(reader, patternResetWhitelist);
 }
 
-void SignalPermDenied()
+void SignalFullReset(reader_t *reader)
 {
-  for (char i = 0; i < 4; i++)
+  SIGNAL_START(reader, patternFullReset);
+}
+
+
+//==================== Signal Player Functions
+
+//Starts a pattern, a running pattern is cut off
+void signalStart(signalPlayer_t *player, const signalStep_t *steps, unsigned char length)
+{
+  player->steps = steps;
+  player->length = length;
+  player->index = 0;
+  player->start = halMillis();
+
+  signalStep_t step;
+  memcpy_P(&step, &steps[0], sizeof(step));
+  signalApply(player, &step);
+}
+
+//Advances the running pattern, called once per loop tick
+void signalUpdate(signalPlayer_t *player)
+{
+  if(player->steps == 0) return;
+
+  signalStep_t step;
+  memcpy_P(&step, &player->steps[player->index], sizeof(step));
+
+  //Catch up on all steps that elapsed since the last tick
+  while(halMillis() - player->start >= step.duration)
   {
-    tone(SIGNALIZER_BUZZER, 3000);
-    LED.set_rgbw(0, color_red);
-    LED.sync();
-    delay(120);
+    player->start += step.duration;
+
+    if(++player->index >= player->length)
+    {
+      player->steps = 0;
+      signalBuzzer(player, 0);
+      return;
+    }
 
-    LED.set_rgbw(0, color_off);
-    LED.sync();
-    noTone(SIGNALIZER_BUZZER);
-    delay(120);
+    memcpy_P(&step, &player->steps[player->index], sizeof(step));
+    signalApply(player, &step);
   }
 }
 
-void SignalReject()
+//Returns 1 while a pattern is playing
+bool signalBusy(const signalPlayer_t *player)
+{
+  return player->steps != 0;
+}
+
+//Drives buzzer and LED pixel for one step
+void signalApply(signalPlayer_t *player, const signalStep_t *step)
 {
-  LED.set_rgbw(0, color_off);
-  LED.sync();
-  tone(SIGNALIZER_BUZZER, 3000);
-  delay(350);
-  LED.set_rgbw(0, color_red);
-  LED.sync();
-  delay(150);
-  LED.set_rgbw(0, color_off);
-  LED.sync();
-  noTone(SIGNALIZER_BUZZER);
+  signalBuzzer(player, step->buzzer);
+
+  switch (step->color)
+  {
+    case colorOff:
+      ledShow(player->pixel, color_off);
+      break;
+    case colorRed:
+      ledShow(player->pixel, color_red);
+      break;
+    case colorGreen:
+      ledShow(player->pixel, color_green);
+      break;
+    default:
+      break;
+  }
 }
 
-void SignalClose()
+//Switches the shared buzzer for one player, it stays on while any player wants it
+void signalBuzzer(signalPlayer_t *player, bool on)
 {
-  tone(SIGNALIZER_BUZZER, 3000);
-  delay(1000);
-  noTone(SIGNALIZER_BUZZER);
+  player->buzzer = on;
+  if(on)
+  {
+    halTone(SIGNALIZER_BUZZER, BUZZER_FREQUENCY);
+    return;
+  }
+
+  for (unsigned char r = 0; r < HAL_READERS; r++)
+    if(readers[r].signal.buzzer) return;
+  halNoTone(SIGNALIZER_BUZZER);
 }
 
-void SignalResetWhitelist()
+//Shows a color on the signal LED pixel of a reader, timed for telemetry
+void ledShow(unsigned char pixel, RGBW color)
 {
-  LED.set_rgbw(0, color_off);
-  LED.sync();
-  tone(SIGNALIZER_BUZZER, 3000);
-  delay(500);
-  noTone(SIGNALIZER_BUZZER);
-  delay(120);
-  tone(SIGNALIZER_BUZZER, 3000);
-  delay(150);
-  noTone(SIGNALIZER_BUZZER);
+  unsigned long probe = telemetryStart();
+  halLedShow(pixel, ledColor(color));
+  telemetryStop(TELEMETRY_LED, probe);
 }
 
-void SignalFullReset()
+//Plays the animation of the reader's state, unless a signal plays or a Tag is held in keying
+void readerGlow(reader_t *reader, unsigned long now)
 {
-  for (char i = 0; i < 2; i++)
-  {
-    tone(SIGNALIZER_BUZZER, 3000);
-    LED.set_rgbw(0, color_off);
-    LED.sync();
-    delay(120);
+  ledAnimation_t animation;
+  memcpy_P(&animation, &stateGlows[reader->state], sizeof(animation));
 
-    noTone(SIGNALIZER_BUZZER);
-    delay(120);
+  if(reader->glow.frames != animation.frames) ledAnimStart(&reader->glow, &animation, now);
+  if(signalBusy(&reader->signal) || (reader->state == keying && reader->RfidPresent.act)) return;
+
+  // Not timed, a frame every tick would flood the telemetry ring
+  halLedShow(reader->index, ledColor(ledAnimFrame(&reader->glow, now)));
+}
+
+
+//==================== Timed Output Functions
+
+//Switches the output on for duration ms, restarts the window if already on
+void outputTrigger(timedOutput_t *output, unsigned long duration)
+{
+  output->start = halMillis();
+  output->duration = duration;
+
+  if(!output->active)
+  {
+    output->active = 1;
+    halPinWrite(output->pin, 1);
   }
-  delay(1500);
+}
 
-  LED.set_rgbw(0, color_green);
-  LED.sync();
-  delay(800);
-  LED.set_rgbw(0, color_off);
-  LED.sync();
+//Switches the output off once its window elapsed
+void outputUpdate(timedOutput_t *output)
+{
+  if(output->active && halMillis() - output->start >= output->duration)
+  {
+    output->active = 0;
+    halPinWrite(output->pin, 0);
+  }
 }
 
 
 //==================== RFID Functions ====================
 
-//Checks if Tag is Master
-bool checkMaster()
+//Checks if Tag is present, one wake-up per call, short dropouts are bridged
+bool tagPresent(reader_t *reader)
 {
-  status = NULL;
-  byte status = mfrc522.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, 2, &key, &(mfrc522.uid));
+  unsigned long now = halMillis();
 
-  if (status != MFRC522::STATUS_OK)
-    return 0;
+  // WUPA also wakes Tags halted by the previous poll
+  if (!halReaderWakeup(reader->index))
+  {
+    reader->presence.lastAbsent = now;
+    if (reader->presence.present && now - reader->presence.lastSeen >= PRESENCE_DEBOUNCE) reader->presence.present = 0;
+    return reader->presence.present;
+  }
 
-  /* Reading data from the Block */
-  status = mfrc522.MIFARE_Read(2, readBlockData, &bufferLen);
-  if (status != MFRC522::STATUS_OK)
-    return 0;
+  if (reader->presence.present)
+  {
+    // Known Tag, send it back to sleep until the next poll
+    halReaderHalt(reader->index);
+  }
   else
   {
-    for (int j = 0; j < 16; j++)
-    {
-      if (blockData[j] != readBlockData[j])
-      {
-        j = 17;
-        return 0;
-      }
-      if (j == 15)
-        return 1;
-    }
+    // New Tag, select it and leave it active for readTag()
+    if (!halReaderSelect(reader->index, &reader->presence.UID)) return 0;
+
+    reader->presence.present = 1;
+    reader->presence.latency = now - reader->presence.lastAbsent;
   }
+
+  reader->presence.lastSeen = now;
+  return 1;
 }
 
-//Checks if Tag is present
-bool tagPresent()
+//Reads UID and master block of the presented Tag in one transaction, returns 1 for a Master
+bool readTag(reader_t *reader)
 {
+  // UID from the anticollision loop, 4, 7 or 10 bytes
+  reader->TagUID = reader->presence.UID;
+
+  bool master = 0;
 
-  if (!mfrc522.PICC_IsNewCardPresent())
+  /* Reading data from the Block */
+  if (halReaderReadBlock(reader->index, blockNum, readBlockData))
+    master = memcmp(readBlockData, blockData, sizeof(blockData)) == 0;
+
+  // Halt the Tag so the next wake-up finds it, leave the reader unencrypted
+  halReaderRelease(reader->index);
+  return master;
+}
+
+//==================== Whitelist Functions ====================
+
+//Removes User from Whitelist, returns 0 if it was no member
+bool whitelistRemove(const tagUID_t *UID)
+{
+  grantCacheRemove(UID);
+  if(!isWhitelistMember(UID) || !whitelistDelete(UID)) return 0;
+
+  whitelistPersist(STORE_OP_REMOVE, UID);
+  return 1;
+}
+
+//Adds User to Whitelist, returns 0 if the Whitelist is full
+bool whitelistAdd(const tagUID_t *UID)
+{
+  if(UID->size == 0 || uidKey(UID) == WHITELIST_EMPTY) return 0;
+  if(isWhitelistMember(UID)) return 1;
+
+#ifdef WHITELIST_FRAM
+  // The FRAM table is the persistent copy
+  return whitelistMemberCount < WHITELIST_SIZE && whitelistInsert(UID);
+#else
+  // Every live record keeps its slots, long UIDs take two
+  unsigned char masterSlots = registeredMaster.size != 0 ? STORE_RECORD_SLOTS(registeredMaster.size) : 0;
+  unsigned int used = whitelistMemberCount + whitelistLongCount + masterSlots;
+  if(whitelistMemberCount >= WHITELIST_SIZE || used + STORE_RECORD_SLOTS(UID->size) + STORE_RESERVE > STORE_SLOTS) return 0;
+
+#ifndef WHITELIST_INDEX
+  // A slot holds one key: a long UID whose key another member has could not be removed on its own
+  if(UID->size > 4 && whitelistFind(UID) != WHITELIST_SLOTS) return 0;
+#endif
+
+  if(!whitelistPersist(STORE_OP_ADD, UID)) return 0;
+
+#ifndef WHITELIST_INDEX
+  whitelistInsert(UID);
+#endif
+  return 1;
+#endif
+}
+
+//Deletes all Users from Whietlist
+void whitelistReset()
+{
+  tagUID_t none = {0};
+  grantCacheClear();
+  whitelistClear();
+
+  whitelistPersist(STORE_OP_CLEAR, &none);
+  return;
+}
+
+//Checks if UID is contained in Whitelist, timed and counted
+bool isWhitelistMember(const tagUID_t *UID)
+{
+  unsigned long probe = telemetryStart();
+  halCount(HAL_COUNT_LOOKUP);
+
+#ifdef WHITELIST_FRAM
+  bool member = whitelistHolds(UID);
+#else
+  // Most strangers are turned away by the Bloom filter without touching the table
+  if(!whitelistBloomMay(uidKey(UID)))
   {
-    if (repeatFlagPresent)
-    {
-      repeatFlagPresent = 0;
-      return 1;
-    }
+    halCount(HAL_COUNT_BLOOM_REJECT);
+    telemetryStop(TELEMETRY_LOOKUP, probe);
     return 0;
   }
-  if (mfrc522.PICC_ReadCardSerial())
-  {
-    if (mfrc522.PICC_IsNewCardPresent())
-    {
-    }
-    if (!mfrc522.PICC_IsNewCardPresent())
-    {
-      if (repeatFlagPresent)
-      {
-        repeatFlagPresent = 0;
-        return 1;
-      }
-      return 0;
-    }
 
-    /* Select one of the cards */
-    if (!mfrc522.PICC_ReadCardSerial())
-    {
-      if (repeatFlagPresent)
-      {
-        repeatFlagPresent = 0;
-        return 1;
-      }
-      return 0;
-    }
-    repeatFlagPresent = 1;
+  bool member = whitelistHolds(UID);
+  if(!member) halCount(HAL_COUNT_BLOOM_FALSE);
+#endif
+
+  telemetryStop(TELEMETRY_LOOKUP, probe);
+  return member;
+}
+
+//Looks UID up behind the Bloom filter, UIDs longer than 4 bytes are confirmed against the store
+bool whitelistHolds(const tagUID_t *UID)
+{
+#ifdef WHITELIST_FRAM
+  // The FRAM holds full UIDs, no confirmation needed
+  return framTableFind(UID);
+#elif defined(WHITELIST_INDEX)
+  return whitelistFind(UID) != WHITELIST_SLOTS;
+#else
+  return whitelistFind(UID) != WHITELIST_SLOTS && (UID->size <= 4 || storeHolds(UID));
+#endif
+}
+
+//Checks if UID may open the door, repeat users are answered by the grant cache
+bool isWhitelistGranted(const tagUID_t *UID)
+{
+  halCount(HAL_COUNT_GRANT_LOOKUP);
+  if(grantCacheFind(UID))
+  {
+    halCount(HAL_COUNT_GRANT_HIT);
     return 1;
   }
+
+  if(!isWhitelistMember(UID)) return 0;
+  grantCacheAdd(UID);
+  return 1;
 }
 
-//Returns Tag UID
-unsigned long getUID()
+#ifndef WHITELIST_FRAM
+
+//Returns the first slot probed for a key (Fibonacci hashing)
+unsigned int whitelistHome(unsigned long key)
 {
-  status = NULL;
-  byte status = mfrc522.PCD_Authenticate(MFRC522::PICC_CMD_MF_AUTH_KEY_A, 2, &key, &(mfrc522.uid));
+  return (uint32_t)(key * 2654435769UL) >> (32 - WHITELIST_SLOTS_BITS);
+}
 
-  if (status != MFRC522::STATUS_OK) return TagUID;
+//Returns the slot holding the key of UID, WHITELIST_SLOTS if there is none
+unsigned int whitelistFind(const tagUID_t *UID)
+{
+  unsigned long key = uidKey(UID);
+  bool isLong = UID->size > 4;
+  if(key == WHITELIST_EMPTY) return WHITELIST_SLOTS;
 
-  /* Reading data from the Block */
-  status = mfrc522.MIFARE_Read(2, readBlockData, &bufferLen);
-  if (status != MFRC522::STATUS_OK) return 0;
-  else
+  unsigned int slot = whitelistHome(key);
+  for (unsigned int probe = 0; probe < WHITELIST_SLOTS; probe++)
   {
-    unsigned long tempUID[4] = {0};
-    for (byte i = 0; i < mfrc522.uid.size; i++)
-    tempUID[i] = mfrc522.uid.uidByte[i];
-
-    volatile unsigned long UID = 0;
-    UID |= (tempUID[0] << 24);
-    UID |= (tempUID[1] << 16);
-    UID |= tempUID[2] << 8;
-    UID |= tempUID[3];
+    halCount(HAL_COUNT_PROBE);
+    if(whitelist[slot] == WHITELIST_EMPTY) break;
+    if(whitelistLongAt(slot) == isLong && whitelistMatch(slot, UID, key)) return slot;
 
-    return UID;    
+    slot = (slot + 1) & (WHITELIST_SLOTS - 1);
   }
+  return WHITELIST_SLOTS;
 }
 
-//==================== Whitelist Functions ====================
+#ifdef WHITELIST_INDEX
 
-//Removes User from Whitelist
-void whitelistRemove(unsigned long UID)
+//Checks if the record the entry in slot points to holds UID
+bool whitelistMatch(unsigned int slot, const tagUID_t *UID, unsigned long key)
 {
-  for (unsigned char searchLoop = 0; searchLoop < WHITELIST_SIZE; searchLoop++)
-  {
-    if (whitelist[searchLoop] == UID)
-    {
-      // Deletes User
-      whitelist[searchLoop] == 0;
+  storeRecord_t record;
 
-      // Moves back the "NULL" value
-      for (int moveLoop = searchLoop; moveLoop < WHITELIST_SIZE; moveLoop++)
-        whitelist[moveLoop] = whitelist[moveLoop + 1];
-      
-      whitelist[WHITELIST_SIZE - 1] = 0x00000000;
+  return storeRecordAt(whitelist[slot] - 1, &record) && uidEqual(&record.UID, UID);
+}
 
-      EEPROM.put(ADDRESS_WHITELIST, whitelist);
+//Returns the key of the member in slot, read from its store record
+unsigned long whitelistKeyAt(unsigned int slot)
+{
+  storeRecord_t record;
 
-      whitelistMemberCount--;
-      EEPROM.put(ADDRESS_WHITELISTCOUNT, whitelistMemberCount);
-      break;
+  if(whitelist[slot] == WHITELIST_EMPTY || !storeRecordAt(whitelist[slot] - 1, &record)) return WHITELIST_EMPTY;
+  return uidKey(&record.UID);
+}
+
+//Points the entry of UID at the store slot of its ADD record, adds the entry if there is none
+void whitelistIndexSet(const tagUID_t *UID, unsigned char storeSlot)
+{
+  unsigned int slot = whitelistFind(UID);
+
+  if(slot == WHITELIST_SLOTS) whitelistPut(UID, storeSlot + 1);
+  else whitelist[slot] = storeSlot + 1;
+}
+
+#else
+
+//Checks if the key in slot is the key of UID
+bool whitelistMatch(unsigned int slot, const tagUID_t *UID, unsigned long key)
+{
+  return whitelist[slot] == key;
+}
+
+//Returns the key of the member in slot
+unsigned long whitelistKeyAt(unsigned int slot)
+{
+  return whitelist[slot];
+}
+
+//Puts the key of UID into the hash table (RAM only), returns 0 if nothing was added
+bool whitelistInsert(const tagUID_t *UID)
+{
+  return whitelistPut(UID, uidKey(UID));
+}
+
+#endif
+
+//Puts the entry of UID into the hash table (RAM only), returns 0 if nothing was added
+bool whitelistPut(const tagUID_t *UID, whitelistEntry_t entry)
+{
+  unsigned long key = uidKey(UID);
+  if(key == WHITELIST_EMPTY || whitelistFind(UID) != WHITELIST_SLOTS) return 0;
+
+  unsigned int slot = whitelistHome(key);
+  for (unsigned int probe = 0; probe < WHITELIST_SLOTS; probe++)
+  {
+    if(whitelist[slot] == WHITELIST_EMPTY)
+    {
+      whitelist[slot] = entry;
+      whitelistLongSet(slot, UID->size > 4);
+      whitelistBloomAdd(key);
+      whitelistMemberCount++;
+      if(UID->size > 4) whitelistLongCount++;
+      return 1;
     }
+
+    slot = (slot + 1) & (WHITELIST_SLOTS - 1);
   }
-  return;
+  return 0;
 }
 
-//Adds User to Whitelist
-void whitelistAdd(unsigned long UID)
+//Takes the key of UID out of the hash table (RAM only), returns 0 if it was not a member
+bool whitelistDelete(const tagUID_t *UID)
 {
-  if(UID == 0) return;
+  unsigned int hole = whitelistFind(UID);
+  if(hole == WHITELIST_SLOTS) return 0;
+
+  if(whitelistLongAt(hole)) whitelistLongCount--;
 
-  for (unsigned char searchLoop = 0; searchLoop < WHITELIST_SIZE; searchLoop++)
+  // Move later entries of the probe chain back, so no chain is cut off
+  unsigned int slot = hole;
+  while(1)
   {
-    if (whitelist[searchLoop] == UID)
+    slot = (slot + 1) & (WHITELIST_SLOTS - 1);
+    if(whitelist[slot] == WHITELIST_EMPTY) break;
+
+    // Entry may only move back if its home is not between hole and slot
+    unsigned int home = whitelistHome(whitelistKeyAt(slot));
+    if(((slot - home) & (WHITELIST_SLOTS - 1)) >= ((slot - hole) & (WHITELIST_SLOTS - 1)))
     {
-      return;
+      whitelist[hole] = whitelist[slot];
+      whitelistLongSet(hole, whitelistLongAt(slot));
+      hole = slot;
     }
   }
 
-  for (unsigned char nextNull = 0; nextNull < WHITELIST_SIZE; nextNull++)
+  whitelist[hole] = WHITELIST_EMPTY;
+  whitelistLongSet(hole, 0);
+  whitelistMemberCount--;
+
+  // Bits can not be taken out, they may be shared with other keys
+  whitelistBloomRebuild();
+  return 1;
+}
+
+//Empties the hash table (RAM only)
+void whitelistClear()
+{
+  for (unsigned int slot = 0; slot < WHITELIST_SLOTS; slot++)
   {
-    if (whitelist[nextNull] == 0 || whitelist[nextNull] == NULL)
-    {
-      whitelist[nextNull] = UID;
-      EEPROM.put(ADDRESS_WHITELIST, whitelist);
+    whitelist[slot] = WHITELIST_EMPTY;
+  }
+  memset(whitelistLong, 0, sizeof(whitelistLong));
+  memset(whitelistBloom, 0, sizeof(whitelistBloom));
+  whitelistMemberCount = 0;
+  whitelistLongCount = 0;
+}
 
-      whitelistMemberCount++;
-      EEPROM.put(ADDRESS_WHITELISTCOUNT, whitelistMemberCount);
-      return;
-    }
+//Returns 1 if the key in slot belongs to a UID longer than 4 bytes
+bool whitelistLongAt(unsigned int slot)
+{
+  return (whitelistLong[slot >> 3] >> (slot & 7)) & 1;
+}
+
+//Marks whether the key in slot belongs to a UID longer than 4 bytes
+void whitelistLongSet(unsigned int slot, bool isLong)
+{
+  if(isLong) whitelistLong[slot >> 3] |= 1 << (slot & 7);
+  else whitelistLong[slot >> 3] &= ~(1 << (slot & 7));
+}
+
+//Returns the Bloom filter bit of one of the hashes of a key (double hashing)
+unsigned int whitelistBloomBit(unsigned long key, unsigned char hash)
+{
+  uint32_t h1 = key * 2654435769UL;
+  uint32_t h2 = ((key ^ (key >> 16)) * 2246822507UL) | 1;
+
+  return (uint32_t)(h1 + hash * h2) >> (32 - WHITELIST_BLOOM_BITS);
+}
+
+//Sets the Bloom filter bits of a key
+void whitelistBloomAdd(unsigned long key)
+{
+  for (unsigned char hash = 0; hash < WHITELIST_BLOOM_HASHES; hash++)
+  {
+    unsigned int bit = whitelistBloomBit(key, hash);
+    whitelistBloom[bit >> 3] |= 1 << (bit & 7);
   }
+}
 
-  // Signal list full reject
-  return;
+//Returns 0 if the key is certainly not in the hash table
+bool whitelistBloomMay(unsigned long key)
+{
+  for (unsigned char hash = 0; hash < WHITELIST_BLOOM_HASHES; hash++)
+  {
+    unsigned int bit = whitelistBloomBit(key, hash);
+    if(!((whitelistBloom[bit >> 3] >> (bit & 7)) & 1)) return 0;
+  }
+  return 1;
 }
 
-//Deletes all Users from Whietlist
-void whitelistReset()
+//Sets up the Bloom filter again from the keys in the hash table
+void whitelistBloomRebuild()
 {
-  for (unsigned char deleteLoop = 0; deleteLoop < WHITELIST_SIZE; deleteLoop++)
+  memset(whitelistBloom, 0, sizeof(whitelistBloom));
+
+  for (unsigned int slot = 0; slot < WHITELIST_SLOTS; slot++)
   {
-    whitelist[deleteLoop] = 0;
+    if(whitelist[slot] != WHITELIST_EMPTY) whitelistBloomAdd(whitelistKeyAt(slot));
   }
+}
 
-  whitelist[WHITELIST_SIZE] = 0;
+#else
+
+//Puts UID into the FRAM table, returns 0 if nothing was added
+bool whitelistInsert(const tagUID_t *UID)
+{
+  bool inserted = !framTableFind(UID) && framTableInsert(UID);
 
-  EEPROM.put(ADDRESS_WHITELIST, whitelist);
+  whitelistMemberCount = framTableCount();
+  return inserted;
+}
+
+//Takes UID out of the FRAM table, returns 0 if it was not a member
+bool whitelistDelete(const tagUID_t *UID)
+{
+  bool deleted = framTableDelete(UID);
 
+  whitelistMemberCount = framTableCount();
+  return deleted;
+}
+
+//Empties the FRAM table, while migrating it is marked once the store is taken over
+void whitelistClear()
+{
+  framTableFormat();
+  if(!whitelistMigrating) framTableCommit();
   whitelistMemberCount = 0;
-  EEPROM.put(ADDRESS_WHITELISTCOUNT, whitelistMemberCount);
-  return;
 }
 
-//Checks if UID is contained in Whitelist
-bool isWhitelistMember(unsigned long UID)
+#endif
+
+//Appends a change to the store
+bool whitelistPersist(unsigned char op, const tagUID_t *UID)
+{
+  storeRecord_t record;
+  record.op = op;
+  record.UID = *UID;
+
+#ifdef WHITELIST_FRAM
+  // Only the Master is kept in the store
+  if(op != STORE_OP_MASTER) return 1;
+#endif
+
+  unsigned long probe = telemetryStart();
+  bool stored = storeAppend(&record);
+
+  telemetryStop(TELEMETRY_STORE, probe);
+  return stored;
+}
+
+//==================== Store Functions ====================
+
+//Applies a stored record while booting
+void storeRecordApply(const storeRecord_t *record, unsigned char slot)
+{
+#ifdef WHITELIST_FRAM
+  // Whitelist records only fill a freshly formatted FRAM table
+  if(record->op != STORE_OP_MASTER && !whitelistMigrating) return;
+#endif
+
+  switch (record->op)
+  {
+    case STORE_OP_ADD:
+#ifdef WHITELIST_INDEX
+      whitelistIndexSet(&record->UID, slot);
+#else
+      whitelistInsert(&record->UID);
+#endif
+      break;
+    case STORE_OP_REMOVE:
+      whitelistDelete(&record->UID);
+      break;
+    case STORE_OP_CLEAR:
+      whitelistClear();
+      break;
+    case STORE_OP_MASTER:
+      registeredMaster = record->UID;
+      break;
+  }
+}
+
+//Tells the store which records still describe the current state
+bool storeRecordLive(const storeRecord_t *record)
 {
-  for (unsigned char searchLoop = 0; searchLoop < WHITELIST_SIZE; searchLoop++)
+  switch (record->op)
   {
-    if (whitelist[searchLoop] == 0 || whitelist[searchLoop] == NULL)
+    case STORE_OP_ADD:
+#ifdef WHITELIST_FRAM
+      // Moved to the FRAM table
+      return 0;
+#else
+      // Newer records for the same UID are checked by the store; long UIDs sharing a key with a member are
+      // confirmed, an ADD from before a CLEAR would be copied forward and come back otherwise
+      return whitelistHolds(&record->UID);
+#endif
+    case STORE_OP_MASTER:
+      return record->UID.size != 0 && uidEqual(&record->UID, &registeredMaster);
+    default:
       return 0;
-    if (whitelist[searchLoop] == UID)
-      return 1;
   }
-  return 0;
+}
+
+//Follows an ADD record to where it was written or copied, the index points at it
+void storeRecordPlaced(const storeRecord_t *record, unsigned char slot)
+{
+#ifdef WHITELIST_INDEX
+  if(record->op == STORE_OP_ADD) whitelistIndexSet(&record->UID, slot);
+#endif
+}
+
+//Hands the fixed-address layout to storeConvert: the Master, then the list up to its first empty entry
+bool storeRecordLegacy(unsigned char index, storeRecord_t *record)
+{
+  uint32_t head;
+
+  if(index > LEGACY_SIZE) return 0;
+  halEepromRead(index == 0 ? ADDRESS_MASTER : ADDRESS_WHITELIST_LEGACY + (index - 1) * sizeof(head), &head, sizeof(head));
+
+  // An empty entry ends the list, without Master there is nothing to convert
+  if(head == LEGACY_ERASED || head == WHITELIST_EMPTY) return 0;
+
+  record->op = index == 0 ? STORE_OP_MASTER : STORE_OP_ADD;
+  uidClear(&record->UID);
+  record->UID.head = head;
+  record->UID.size = 4;
+  return 1;
 }
 
 //==================== Master Functions ====================
 
 //Sets the Master Tag
-void masterSet(unsigned long UID)
+void masterSet(const tagUID_t *UID)
 {
-  registeredMaster = UID;
-  EEPROM.put(ADDRESS_MASTER, registeredMaster);
+  registeredMaster = *UID;
+  whitelistPersist(STORE_OP_MASTER, &registeredMaster);
 }
 
 //Resets the Master Tag
 void masterReset()
 {
-  registeredMaster = 0;
-  EEPROM.put(ADDRESS_MASTER, registeredMaster);
+  uidClear(&registeredMaster);
+  grantCacheClear();
+  whitelistPersist(STORE_OP_MASTER, &registeredMaster);
+}
+
+//==================== Provisioning Functions ====================
+
+//Adds a UID sent over the serial line, returns 0 if the Whitelist is full
+bool provisionAdd(const tagUID_t *UID)
+{
+  return whitelistAdd(UID);
+}
+
+//Removes a UID sent over the serial line, returns 0 if it was no member
+bool provisionRemove(const tagUID_t *UID)
+{
+  return whitelistRemove(UID);
+}
+
+//Empties the Whitelist before a full provisioning
+void provisionClear()
+{
+  whitelistReset();
+}
+
+//Logs the end of a provisioning session
+void provisionDone(unsigned int applied)
+{
+  tagUID_t none = {0};
+  none.head = applied;
+
+  eventLog(EVENT_PROVISION, EVENTLOG_NO_READER, &none, 0);
+}
+
+
+//==================== Check Functions ====================
+
+//Checks Whitelist, grant cache and Master against their invariants, with store also against the EEPROM; returns the first violation or 0
+const char *invariantCheck(bool store)
+{
+#ifdef WHITELIST_FRAM
+  if(whitelistMemberCount != framTableCount()) return "member count differs from the FRAM table";
+#else
+  unsigned int members = 0;
+  unsigned int longs = 0;
+
+  for (unsigned int slot = 0; slot < WHITELIST_SLOTS; slot++)
+  {
+    if(whitelist[slot] == WHITELIST_EMPTY)
+    {
+      if(whitelistLongAt(slot)) return "long mark on an empty slot";
+      continue;
+    }
+
+    members++;
+    if(whitelistLongAt(slot)) longs++;
+
+    unsigned long key = whitelistKeyAt(slot);
+    if(key == WHITELIST_EMPTY) return "entry without key";
+    if(!whitelistBloomMay(key)) return "entry missing in the Bloom filter";
+
+    // Lookups stop at the first empty slot after the home
+    for (unsigned int probe = whitelistHome(key); probe != slot; probe = (probe + 1) & (WHITELIST_SLOTS - 1))
+    {
+      if(whitelist[probe] == WHITELIST_EMPTY) return "entry cut off from its home";
+    }
+  }
+  if(members != whitelistMemberCount) return "member count differs from the hash table";
+  if(longs != whitelistLongCount) return "long UID count differs from the hash table";
+#endif
+  if(whitelistMemberCount > WHITELIST_SIZE) return "more members than WHITELIST_SIZE";
+
+  // Only members may be let in by the grant cache
+  for (unsigned char entry = 0; entry < GRANT_CACHE_ENTRIES; entry++)
+  {
+    tagUID_t UID;
+    if(grantCacheEntry(entry, &UID) && !whitelistHolds(&UID)) return "grant cache holds a non-member";
+  }
+
+  if(!store) return 0;
+
+  //A power cycle has to bring back the same Master and Whitelist
+  tagUID_t master;
+  storeMaster(&master);
+  if(!uidEqual(&master, &registeredMaster) && (master.size != 0 || registeredMaster.size != 0)) return "Master differs from the store";
+
+#ifndef WHITELIST_FRAM
+  unsigned int held = 0;
+
+  for (unsigned char slot = 0; slot < STORE_SLOTS; slot++)
+  {
+    storeRecord_t record;
+    if(!storeRecordAt(slot, &record) || record.op != STORE_OP_ADD) continue;
+
+    bool stored = storeHolds(&record.UID);
+    if(stored != whitelistHolds(&record.UID)) return stored ? "stored member missing in RAM" : "removed member still in RAM";
+
+    // Each UID counts once, at its first record
+    bool first = 1;
+    for (unsigned char before = 0; before < slot && first; before++)
+    {
+      storeRecord_t earlier;
+      if(storeRecordAt(before, &earlier) && earlier.op == STORE_OP_ADD && uidEqual(&earlier.UID, &record.UID)) first = 0;
+    }
+    if(stored && first) held++;
+  }
+  if(held != whitelistMemberCount) return "member count differs from the store";
+#endif
+  return 0;
+}
+
+//Returns a digest of Master and Whitelist that does not depend on the slots members took, the simulator compares boots after power cuts with it
+unsigned long stateDigest()
+{
+  unsigned long digest = 0;
+
+#ifndef WHITELIST_FRAM
+  // Sum of mixed keys, the order of the slots does not matter
+  for (unsigned int slot = 0; slot < WHITELIST_SLOTS; slot++)
+  {
+    if(whitelist[slot] == WHITELIST_EMPTY) continue;
+
+    uint32_t mixed = (whitelistKeyAt(slot) + whitelistLongAt(slot)) * 2654435769UL;
+    digest += mixed ^ (mixed >> 15);
+  }
+#else
+  // The FRAM table by its count, one filled only in part has fewer
+  digest += framTableCount() * 2654435769UL;
+#endif
+  if(registeredMaster.size != 0) digest ^= (uint32_t)(uidKey(&registeredMaster) * 40503UL + registeredMaster.size);
+  return digest;
 }
@@ -0,0 +1,136 @@
+//==================== Includes ====================
+
+#include "frame.h"
+#include "hal.h"
+#include "provision.h"
+
+#if PROVISION_ACK_SIZE > FRAME_PAYLOAD_MAX
+#error "Provisioning acknowledge does not fit into one frame"
+#endif
+
+//==================== Function Prototypes ====================
+
+bool provisionCheck(const unsigned char *payload, unsigned char length);
+void provisionBatch(unsigned char type, const unsigned char *payload, unsigned char length);
+
+//==================== Global Variables ====================
+
+/*Session*/
+bool provisionOpen = 0;
+unsigned long provisionStart = 0;
+unsigned int provisionApplied = 0;
+unsigned int provisionFailed = 0;
+
+/*Acknowledge waiting for the transmitter*/
+bool provisionAckPending = 0;
+unsigned char provisionAckType = 0;
+unsigned char provisionAckBatch = 0;
+unsigned char provisionAckStatus = 0;
+
+
+//==================== Provisioning Functions ====================
+
+//Handles the frame frameReceive() completed, returns 1 if it was a provisioning frame that was taken
+bool provisionFrame(bool unlocked)
+{
+  unsigned char type, length;
+  const unsigned char *payload = frameReceived(&type, &length);
+
+  if(type < FRAME_PROVISION_BEGIN || type > FRAME_PROVISION_END) return 0;
+
+  provisionAckPending = 1;
+  provisionAckType = type;
+  provisionAckBatch = length != 0 ? payload[0] : 0;
+  provisionAckStatus = PROVISION_OK;
+
+  if(!unlocked)
+  {
+    provisionAckStatus = PROVISION_LOCKED;
+    return 0;
+  }
+
+  if(!provisionOpen || type == FRAME_PROVISION_BEGIN)
+  {
+    provisionOpen = 1;
+    provisionStart = halMillis();
+    provisionApplied = 0;
+    provisionFailed = 0;
+  }
+
+  switch (type)
+  {
+    case FRAME_PROVISION_BEGIN:
+      if(length != 0 && (payload[0] & PROVISION_REPLACE)) provisionClear();
+      break;
+    case FRAME_PROVISION_ADD:
+    case FRAME_PROVISION_REMOVE:
+      if(!provisionCheck(payload, length)) provisionAckStatus = PROVISION_MALFORMED;
+      else provisionBatch(type, payload, length);
+      break;
+    case FRAME_PROVISION_END:
+      provisionOpen = 0;
+      provisionDone(provisionApplied);
+      break;
+  }
+  return 1;
+}
+
+//Sends the acknowledge once the transmitter is free, called once per loop tick
+void provisionUpdate()
+{
+  if(!provisionAckPending) return;
+
+  unsigned char *payload = frameStart(FRAME_PROVISION_ACK);
+  if(payload == 0) return;
+
+  unsigned long elapsed = halMillis() - provisionStart;
+  unsigned char length = 0;
+
+  payload[length++] = provisionAckType;
+  payload[length++] = provisionAckBatch;
+  payload[length++] = provisionAckStatus;
+  payload[length++] = provisionApplied & 0xFF;
+  payload[length++] = provisionApplied >> 8;
+  payload[length++] = provisionFailed & 0xFF;
+  payload[length++] = provisionFailed >> 8;
+  for (unsigned char b = 0; b < 4; b++)
+    payload[length++] = elapsed >> (8 * b);
+
+  frameFinish(length);
+  provisionAckPending = 0;
+}
+
+//Checks a batch before anything of it is applied: batch number, then UIDs of 4, 7 or 10 bytes
+bool provisionCheck(const unsigned char *payload, unsigned char length)
+{
+  if(length == 0) return 0;
+
+  for (unsigned char i = 1; i < length; i += 1 + payload[i])
+  {
+    unsigned char size = payload[i];
+    if((size != 4 && size != 7 && size != 10) || i + 1 + size > length) return 0;
+  }
+  return 1;
+}
+
+//Applies all UIDs of a checked batch
+void provisionBatch(unsigned char type, const unsigned char *payload, unsigned char length)
+{
+  for (unsigned char i = 1; i < length; i += 1 + payload[i])
+  {
+    tagUID_t UID;
+    uidSet(&UID, &payload[i + 1], payload[i]);
+
+    if(type == FRAME_PROVISION_REMOVE)
+    {
+      if(!provisionRemove(&UID)) continue;
+    }
+    else if(!provisionAdd(&UID))
+    {
+      provisionFailed++;
+      provisionAckStatus = PROVISION_FULL;
+      continue;
+    }
+    provisionApplied++;
+  }
+}
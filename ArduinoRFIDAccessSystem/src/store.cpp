@@ -0,0 +1,365 @@
+//==================== Includes ====================
+
+#include <stddef.h>
+#include <string.h>
+#include "crc8.h"
+#include "hal.h"
+#include "store.h"
+
+
+//==================== Defines ====================
+
+/*Written last by storeConvert, marks a formatted store*/
+#define STORE_MAGIC 0x31534652 // "RFS1"
+/*Stages of storeConvert before it, each step on changes one byte and a cut one reads erased*/
+#define STORE_MAGIC_UPPER 0x63434652 // "RFCc", the slots from the first on are written
+#define STORE_MAGIC_LOWER 0x31434652 // "RFC1", all records are written, the rest is erased next
+#define STORE_MAGIC_STAGE 0xFFFF     // Bytes shared by all stages
+
+/*Payload bytes per slot*/
+#define STORE_DATA_SIZE 5
+
+//==================== Objects ====================
+
+/*Slot as stored in EEPROM*/
+typedef struct
+{
+  unsigned char seq;                    // Increments by one per written slot
+  unsigned char type;                   // Operation (high nibble) and UID size (low nibble)
+  unsigned char data[STORE_DATA_SIZE];  // UID head least significant byte first, then tail
+  unsigned char crc;                    // CRC-8 over all bytes before
+} storeSlot_t;
+
+//==================== Function Prototypes ====================
+
+unsigned int storeAddress(unsigned char slot);
+unsigned char storeDistance(unsigned char slot);
+bool storeRead(unsigned char slot, storeSlot_t *raw);
+bool storeLoad(unsigned char slot, storeRecord_t *record, unsigned char *slots);
+void storeProgram(const storeRecord_t *record);
+void storePut(const storeRecord_t *record);
+void storeWrite(const storeSlot_t *raw);
+void storeErase(unsigned char slot);
+bool storeLive(unsigned char slot, const storeRecord_t *record);
+
+//==================== Global Variables ====================
+
+/*Next slot to write, this and the STORE_RESERVE - 1 slots after it hold no live record*/
+unsigned char storeWriteSlot = 0;
+/*Sequence number of the next slot written*/
+unsigned char storeSeq = 0;
+
+
+//==================== Store Functions ====================
+
+//Finds the newest record, returns 0 if the EEPROM holds no store
+bool storeBegin()
+{
+  uint32_t magic;
+  halEepromRead(STORE_ADDRESS_MAGIC, &magic, sizeof(magic));
+  if(magic != STORE_MAGIC) return 0;
+
+  storeWriteSlot = 0;
+  storeSeq = 0;
+
+  // The newest slot is the one its successor does not continue
+  for (unsigned char slot = 0; slot < STORE_SLOTS; slot++)
+  {
+    storeSlot_t raw, next;
+
+    if(!storeRead(slot, &raw)) continue;
+    if(storeRead((slot + 1) % STORE_SLOTS, &next) && next.seq == (unsigned char)(raw.seq + 1)) continue;
+
+    storeWriteSlot = (slot + 1) % STORE_SLOTS;
+    storeSeq = raw.seq + 1;
+
+    // First half of a record cut off by power loss, its slot is free again
+    if((raw.type >> 4) != STORE_OP_EXT && STORE_RECORD_SLOTS(raw.type & 0x0F) == 2)
+    {
+      storeWriteSlot = slot;
+      storeSeq = raw.seq;
+    }
+    break;
+  }
+  return 1;
+}
+
+//Builds the store from the records storeRecordLegacy hands out, read from cells below slot first; the magic goes last,
+//a stage cut off by power loss is done again
+void storeConvert(unsigned char first)
+{
+  uint32_t magic;
+  storeSlot_t raw;
+  storeRecord_t record;
+  unsigned char index = 0;
+  unsigned char slot;
+
+  halEepromRead(STORE_ADDRESS_MAGIC, &magic, sizeof(magic));
+  bool upper = (magic & STORE_MAGIC_STAGE) == (STORE_MAGIC & STORE_MAGIC_STAGE);
+  bool lower = upper && magic >> 24 == STORE_MAGIC >> 24;
+  // Nothing to convert, as on a new chip: all slots are erased and marked at once
+  bool empty = !upper && !storeRecordLegacy(0, &record);
+
+  // Upper slots first, they hold none of the cells read
+  if(!upper && !empty)
+  {
+    bool more = 1;
+
+    storeWriteSlot = first;
+    storeSeq = 0;
+    for (slot = first; slot < STORE_SLOTS; slot++)
+    {
+      more = more && storeRecordLegacy(index++, &record);
+      if(more) storePut(&record);
+      else storeErase(slot);
+    }
+
+    magic = STORE_MAGIC_UPPER;
+    halEepromWrite(STORE_ADDRESS_MAGIC, &magic, sizeof(magic));
+  }
+
+  // Lower slots over cells taken over already, the slot behind the last record is erased as the end mark
+  if(!lower && !empty)
+  {
+    // Only records that filled the upper slots go on
+    bool more = storeRead(STORE_SLOTS - 1, &raw);
+
+    storeWriteSlot = 0;
+    storeSeq = STORE_SLOTS - first;
+    for (index = STORE_SLOTS - first; more && storeWriteSlot < first; )
+    {
+      more = storeRecordLegacy(index++, &record);
+      if(more) storePut(&record);
+    }
+    if(storeWriteSlot < first) storeErase(storeWriteSlot);
+
+    magic = STORE_MAGIC_LOWER;
+    halEepromWrite(STORE_ADDRESS_MAGIC, &magic, sizeof(magic));
+  }
+
+  // The old cells left behind the end mark could read as records
+  for (slot = 0; !empty && slot < first && storeRead(slot, &raw); slot++);
+  for (; slot < (empty ? STORE_SLOTS : first); slot++) storeErase(slot);
+
+  magic = STORE_MAGIC;
+  halEepromWrite(STORE_ADDRESS_MAGIC, &magic, sizeof(magic));
+}
+
+//Passes all records to storeRecordApply, oldest first
+void storeReplay()
+{
+  unsigned char slots;
+
+  for (unsigned char step = 0; step < STORE_SLOTS; step += slots)
+  {
+    storeRecord_t record;
+
+    unsigned char slot = (storeWriteSlot + step) % STORE_SLOTS;
+
+    if(storeLoad(slot, &record, &slots)) storeRecordApply(&record, slot);
+  }
+}
+
+//Appends a record, returns 0 if no slots could be freed
+bool storeAppend(const storeRecord_t *record)
+{
+  // Slots from storeWriteSlot on that are known to be dead
+  unsigned char dead = 1;
+  unsigned char needed = STORE_RECORD_SLOTS(record->UID.size) + STORE_RESERVE;
+
+  halCount(HAL_COUNT_STORE_APPEND);
+  for (unsigned char step = 0; dead < needed; step++)
+  {
+    if(step >= STORE_SLOTS) return 0;
+
+    unsigned char slot = (storeWriteSlot + dead) % STORE_SLOTS;
+    unsigned char slots;
+    storeRecord_t old;
+
+    if(!storeLoad(slot, &old, &slots) || !storeLive(slot, &old))
+    {
+      dead += slots;
+      continue;
+    }
+
+    // Live record: copy it forward, its old slots join the dead range
+    if(slots > dead) return 0;
+    storeProgram(&old);
+  }
+
+  storeProgram(record);
+  return 1;
+}
+
+//Checks if the stored records leave UID in the Whitelist
+bool storeHolds(const tagUID_t *UID)
+{
+  bool member = 0;
+  unsigned char slots;
+
+  for (unsigned char step = 0; step < STORE_SLOTS; step += slots)
+  {
+    storeRecord_t record;
+
+    if(!storeLoad((storeWriteSlot + step) % STORE_SLOTS, &record, &slots)) continue;
+
+    if(record.op == STORE_OP_CLEAR) member = 0;
+    else if(record.op != STORE_OP_MASTER && uidEqual(&record.UID, UID)) member = record.op == STORE_OP_ADD;
+  }
+  return member;
+}
+
+//Finds the Master the stored records leave, size 0 if there is none
+void storeMaster(tagUID_t *UID)
+{
+  unsigned char slots;
+
+  uidClear(UID);
+  for (unsigned char step = 0; step < STORE_SLOTS; step += slots)
+  {
+    storeRecord_t record;
+
+    if(storeLoad((storeWriteSlot + step) % STORE_SLOTS, &record, &slots) && record.op == STORE_OP_MASTER) *UID = record.UID;
+  }
+}
+
+//Reads the record starting at slot, returns 0 if there is none
+bool storeRecordAt(unsigned char slot, storeRecord_t *record)
+{
+  unsigned char slots;
+
+  return storeLoad(slot, record, &slots);
+}
+
+
+//==================== Slot Functions ====================
+
+//Returns the EEPROM address of a slot
+unsigned int storeAddress(unsigned char slot)
+{
+  return STORE_BEGIN + slot * STORE_SLOT_SIZE;
+}
+
+//Returns how many slots lie between slot and storeWriteSlot
+unsigned char storeDistance(unsigned char slot)
+{
+  return (storeWriteSlot + STORE_SLOTS - slot) % STORE_SLOTS;
+}
+
+//Reads a slot, returns 0 if its CRC or type is invalid
+bool storeRead(unsigned char slot, storeSlot_t *raw)
+{
+  halEepromRead(storeAddress(slot), raw, sizeof(storeSlot_t));
+
+  if(raw->crc != crc8((unsigned char *)raw, offsetof(storeSlot_t, crc))) return 0;
+  return (raw->type >> 4) >= STORE_OP_ADD && (raw->type >> 4) <= STORE_OP_EXT;
+}
+
+//Reads the record starting at slot, returns 0 if there is none; slots is set to the slots it covers
+bool storeLoad(unsigned char slot, storeRecord_t *record, unsigned char *slots)
+{
+  storeSlot_t raw, ext;
+  *slots = 1;
+
+  if(!storeRead(slot, &raw)) return 0;
+
+  record->op = raw.type >> 4;
+  if(record->op == STORE_OP_EXT) return 0;
+
+  uidClear(&record->UID);
+  record->UID.size = raw.type & 0x0F;
+  if(record->UID.size > UID_MAX_SIZE) return 0;
+
+  for (unsigned char i = 0; i < 4; i++)
+    record->UID.head |= (unsigned long)raw.data[i] << (8 * i);
+  record->UID.tail[0] = raw.data[4];
+
+  if(STORE_RECORD_SLOTS(record->UID.size) == 1) return 1;
+
+  // The rest of the UID follows in the next slot
+  if(!storeRead((slot + 1) % STORE_SLOTS, &ext)) return 0;
+  if((ext.type >> 4) != STORE_OP_EXT || ext.seq != (unsigned char)(raw.seq + 1)) return 0;
+
+  *slots = 2;
+  memcpy(&record->UID.tail[1], ext.data, UID_TAIL_SIZE - 1);
+  return 1;
+}
+
+//Writes a record at storeWriteSlot and moves on, the application learns where it went
+void storeProgram(const storeRecord_t *record)
+{
+  unsigned char slot = storeWriteSlot;
+
+  storePut(record);
+  storeRecordPlaced(record, slot);
+}
+
+//Writes a record at storeWriteSlot and moves on
+void storePut(const storeRecord_t *record)
+{
+  storeSlot_t raw = {0};
+  unsigned char size = record->op == STORE_OP_CLEAR ? 0 : record->UID.size;
+
+  raw.type = record->op << 4 | size;
+  for (unsigned char i = 0; i < 4; i++)
+    raw.data[i] = record->UID.head >> (8 * i);
+  raw.data[4] = record->UID.tail[0];
+  storeWrite(&raw);
+
+  if(STORE_RECORD_SLOTS(size) == 2)
+  {
+    // Second slot after the first, a cut-off pair leaves the first without continuation
+    storeSlot_t ext = {0};
+    ext.type = STORE_OP_EXT << 4 | size;
+    memcpy(ext.data, &record->UID.tail[1], UID_TAIL_SIZE - 1);
+    storeWrite(&ext);
+  }
+}
+
+//Writes one slot at storeWriteSlot, the type byte goes last so a cut-off write stays invalid
+void storeWrite(const storeSlot_t *raw)
+{
+  storeSlot_t slot = *raw;
+  unsigned int address = storeAddress(storeWriteSlot);
+
+  slot.seq = storeSeq++;
+  slot.crc = crc8((unsigned char *)&slot, offsetof(storeSlot_t, crc));
+
+  storeErase(storeWriteSlot);
+  halEepromWrite(address, &slot.seq, 1);
+  halEepromWrite(address + offsetof(storeSlot_t, data), slot.data, STORE_SLOT_SIZE - offsetof(storeSlot_t, data));
+  halEepromWrite(address + offsetof(storeSlot_t, type), &slot.type, 1);
+
+  storeWriteSlot = (storeWriteSlot + 1) % STORE_SLOTS;
+}
+
+//Marks a slot as holding no record
+void storeErase(unsigned char slot)
+{
+  unsigned char erased = 0xFF;
+
+  halEepromWrite(storeAddress(slot) + offsetof(storeSlot_t, type), &erased, 1);
+}
+
+//Checks if a record must survive: still wanted and not overridden by a newer one
+bool storeLive(unsigned char slot, const storeRecord_t *record)
+{
+  if(!storeRecordLive(record)) return 0;
+
+  unsigned char remaining = storeDistance(slot);
+  unsigned char slots = STORE_RECORD_SLOTS(record->UID.size);
+
+  for (unsigned char step = slots; step < remaining; step += slots)
+  {
+    storeRecord_t newer;
+
+    if(!storeLoad((slot + step) % STORE_SLOTS, &newer, &slots)) continue;
+
+    if(record->op == STORE_OP_MASTER)
+    {
+      if(newer.op == STORE_OP_MASTER) return 0;
+    }
+    else if((newer.op == STORE_OP_ADD || newer.op == STORE_OP_REMOVE) && uidEqual(&newer.UID, &record->UID)) return 0;
+  }
+  return 1;
+}
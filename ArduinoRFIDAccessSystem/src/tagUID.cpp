@@ -0,0 +1,58 @@
+//==================== Includes ====================
+
+#include <string.h>
+#include "tagUID.h"
+
+
+//==================== UID Functions ====================
+
+//Packs the UID bytes reported by the reader
+void uidSet(tagUID_t *UID, const unsigned char *bytes, unsigned char size)
+{
+  if(size > UID_MAX_SIZE) size = UID_MAX_SIZE;
+
+  uidClear(UID);
+  UID->size = size;
+
+  for (unsigned char i = 0; i < size; i++)
+  {
+    if(i < 4) UID->head |= (unsigned long)bytes[i] << (8 * (3 - i));
+    else UID->tail[i - 4] = bytes[i];
+  }
+}
+
+//Unpacks the UID bytes as the reader reported them, returns their number
+unsigned char uidBytes(const tagUID_t *UID, unsigned char *bytes)
+{
+  for (unsigned char i = 0; i < UID->size; i++)
+  {
+    if(i < 4) bytes[i] = UID->head >> (8 * (3 - i));
+    else bytes[i] = UID->tail[i - 4];
+  }
+  return UID->size;
+}
+
+//Sets UID to "no UID"
+void uidClear(tagUID_t *UID)
+{
+  memset(UID, 0, sizeof(tagUID_t));
+}
+
+//Checks if two UIDs are the same
+bool uidEqual(const tagUID_t *a, const tagUID_t *b)
+{
+  return a->head == b->head && a->size == b->size && memcmp(a->tail, b->tail, UID_TAIL_SIZE) == 0;
+}
+
+//Returns a 32 bit key: the UID itself for 4 byte UIDs, a fold of all bytes otherwise
+unsigned long uidKey(const tagUID_t *UID)
+{
+  uint32_t key = UID->head;
+
+  // FNV-1a step per tail byte
+  for (unsigned char i = 4; i < UID->size; i++)
+    key = (key ^ UID->tail[i - 4]) * 16777619UL;
+
+  if(key == 0 && UID->size > 4) key = 1;
+  return key;
+}
@@ -0,0 +1,138 @@
+//==================== Includes ====================
+
+#include "frame.h"
+#include "grantCache.h"
+#include "hal.h"
+#include "telemetry.h"
+
+#if 2 + 3 * TELEMETRY_SAMPLES > FRAME_PAYLOAD_MAX
+#error "Telemetry ring does not fit into one frame"
+#endif
+#if TELEMETRY_STATUS_SIZE > FRAME_PAYLOAD_MAX
+#error "Telemetry status does not fit into one frame"
+#endif
+
+
+//==================== Objects ====================
+
+typedef struct
+{
+  unsigned char probe;
+  uint16_t duration;
+} telemetrySample_t;
+
+//==================== Global Variables ====================
+
+telemetrySample_t telemetryRing[TELEMETRY_SAMPLES];
+unsigned char telemetryNext = 0;      // Slot of the next sample
+unsigned char telemetryCount = 0;     // Samples in the ring
+unsigned char telemetryDropped = 0;   // Samples overwritten since the last dump, saturating
+bool telemetryDumpPending = 0;
+
+/*Status*/
+unsigned long telemetryBootTime = 0;
+unsigned int telemetryFreeRam = 0;
+unsigned int telemetryMembers = 0;
+bool telemetryStatusPending = 0;
+
+
+//==================== Telemetry Functions ====================
+
+//Returns the time stamp a probe starts from
+unsigned long telemetryStart()
+{
+  return halMicros();
+}
+
+//Records the time since start for probe
+void telemetryStop(unsigned char probe, unsigned long start)
+{
+  unsigned long duration = halMicros() - start;
+
+  telemetryRing[telemetryNext].probe = probe;
+  telemetryRing[telemetryNext].duration = duration > 0xFFFF ? 0xFFFF : duration;
+  telemetryNext = (telemetryNext + 1) % TELEMETRY_SAMPLES;
+
+  if(telemetryCount < TELEMETRY_SAMPLES) telemetryCount++;
+  else if(telemetryDropped < 0xFF) telemetryDropped++;
+}
+
+//Requests a dump of the ring, sent once the serial line is free
+void telemetryDump()
+{
+  telemetryDumpPending = 1;
+}
+
+//Sends the ring as one frame and empties it, returns 0 if the serial line is busy
+bool telemetrySendDump()
+{
+  unsigned char *payload = frameStart(FRAME_TELEMETRY);
+  if(payload == 0) return 0;
+
+  unsigned char length = 0;
+  unsigned char slot = (telemetryNext + TELEMETRY_SAMPLES - telemetryCount) % TELEMETRY_SAMPLES;
+
+  payload[length++] = telemetryCount;
+  payload[length++] = telemetryDropped;
+
+  for (unsigned char i = 0; i < telemetryCount; i++)
+  {
+    payload[length++] = telemetryRing[slot].probe;
+    payload[length++] = telemetryRing[slot].duration & 0xFF;
+    payload[length++] = telemetryRing[slot].duration >> 8;
+    slot = (slot + 1) % TELEMETRY_SAMPLES;
+  }
+
+  frameFinish(length);
+  telemetryCount = 0;
+  telemetryDropped = 0;
+  return 1;
+}
+
+//Records the time since start as boot time and the least free SRAM during setup, the status is sent once the serial line is free
+void telemetryBoot(unsigned long start, unsigned int members)
+{
+  telemetryBootTime = halMicros() - start;
+  telemetryFreeRam = halFreeRam();
+  telemetryMembers = members;
+  telemetryStatusPending = 1;
+}
+
+//Requests the status frame again
+void telemetryStatus()
+{
+  telemetryStatusPending = 1;
+}
+
+//Sends a requested dump and status frame once the transmitter is free, called once per loop tick
+void telemetryUpdate()
+{
+  if(telemetryDumpPending && telemetrySendDump()) telemetryDumpPending = 0;
+  if(!telemetryStatusPending) return;
+
+  unsigned char *payload = frameStart(FRAME_STATUS);
+  if(payload == 0) return;
+
+  unsigned long hits, misses, sent, elided;
+  grantCacheStats(&hits, &misses);
+  halLedStats(&sent, &elided);
+
+  unsigned char length = 0;
+  for (unsigned char b = 0; b < 4; b++)
+    payload[length++] = telemetryBootTime >> (8 * b);
+  payload[length++] = telemetryFreeRam & 0xFF;
+  payload[length++] = telemetryFreeRam >> 8;
+  payload[length++] = telemetryMembers & 0xFF;
+  payload[length++] = telemetryMembers >> 8;
+  for (unsigned char b = 0; b < 4; b++)
+    payload[length++] = hits >> (8 * b);
+  for (unsigned char b = 0; b < 4; b++)
+    payload[length++] = misses >> (8 * b);
+  for (unsigned char b = 0; b < 4; b++)
+    payload[length++] = sent >> (8 * b);
+  for (unsigned char b = 0; b < 4; b++)
+    payload[length++] = elided >> (8 * b);
+
+  frameFinish(length);
+  telemetryStatusPending = 0;
+}
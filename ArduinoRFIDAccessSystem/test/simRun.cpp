@@ -0,0 +1,110 @@
+//==================== Includes ====================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "simRun.h"
+
+//==================== Defines ====================
+
+/*Options of one run*/
+#define SIM_RUN_ARGS 32
+
+//==================== Function Prototypes ====================
+
+int simMain(int argc, char **argv);
+
+const char *simRunEvent(const char *line, unsigned long *time);
+
+//==================== Functions ====================
+
+//Runs the simulator with the options (separated by spaces) on a trace, returns its output (free() it) and exit code
+char *simRun(const char *options, const char *trace, int *status)
+{
+  FILE *input = tmpfile();
+  FILE *output = tmpfile();
+  if (!input || !output) return 0;
+
+  fputs(trace, input);
+  fflush(input);
+  rewind(input);
+  fflush(stdout);
+
+  pid_t child = fork();
+  if (child == 0)
+  {
+    char words[256];
+    char *argv[SIM_RUN_ARGS + 1] = {(char *)"program"};
+    int argc = 1;
+
+    snprintf(words, sizeof(words), "%s", options);
+    for (char *word = strtok(words, " "); word && argc < SIM_RUN_ARGS; word = strtok(0, " ")) argv[argc++] = word;
+
+    dup2(fileno(input), 0);
+    dup2(fileno(output), 1);
+    exit(simMain(argc, argv));
+  }
+
+  int code = -1;
+  if (child > 0 && waitpid(child, &code, 0) == child && WIFEXITED(code)) code = WEXITSTATUS(code);
+  else code = -1;
+  if (status) *status = code;
+
+  fseek(output, 0, SEEK_END);
+  long size = ftell(output);
+  rewind(output);
+
+  char *text = (char *)malloc(size + 1);
+  text[fread(text, 1, size, output)] = 0;
+  fclose(input);
+  fclose(output);
+  return text;
+}
+
+//Returns the time in ms of the first output line from that time on starting with event, -1 if there is none
+long simFind(const char *output, const char *event, unsigned long from)
+{
+  for (const char *line = output; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : 0)
+  {
+    unsigned long time;
+    const char *text = simRunEvent(line, &time);
+
+    if (text && time >= from && strncmp(text, event, strlen(event)) == 0) return time;
+  }
+  return -1;
+}
+
+//Counts the output lines in [from, to) ms starting with event
+unsigned long simCount(const char *output, const char *event, unsigned long from, unsigned long to)
+{
+  unsigned long count = 0;
+
+  for (const char *line = output; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : 0)
+  {
+    unsigned long time;
+    const char *text = simRunEvent(line, &time);
+
+    if (text && time >= from && time < to && strncmp(text, event, strlen(event)) == 0) count++;
+  }
+  return count;
+}
+
+//Returns the number after key on the statistics line starting with it, -1 if there is none
+double simValue(const char *output, const char *key)
+{
+  for (const char *line = output; line && *line; line = strchr(line, '\n') ? strchr(line, '\n') + 1 : 0)
+    if (strncmp(line, key, strlen(key)) == 0) return atof(line + strlen(key));
+  return -1;
+}
+
+//Splits an output line into time and event text, returns 0 for lines without time (statistics)
+const char *simRunEvent(const char *line, unsigned long *time)
+{
+  int used = 0;
+
+  if (line[0] != ' ' && (line[0] < '0' || line[0] > '9')) return 0;
+  if (sscanf(line, "%lu %n", time, &used) != 1 || used == 0) return 0;
+  return line + used;
+}
@@ -0,0 +1,28 @@
+#ifndef SIM_RUN_H
+#define SIM_RUN_H
+
+/*
+  Runs the native simulator (src/hal_native.cpp) from a unit test.
+
+  simRun() forks, feeds the trace to simMain() in the child and returns
+  everything it printed; each run starts from the state the test process
+  had, so runs do not affect each other. The output lines are looked up
+  by their text after the time column, e.g. "tone 14 3000" or "pin 17 high".
+*/
+
+//==================== Defines ====================
+
+/*Master Tag of the traces, registered by SIM_RUN_MASTER_TRACE*/
+#define SIM_RUN_MASTER "A0B0C0D0"
+
+/*Registers the Master at 1000 ms and lets keying time out, the reader is idle from 13000 ms*/
+#define SIM_RUN_MASTER_TRACE "1000 tag " SIM_RUN_MASTER " master\n1250 none\n"
+
+//==================== Function Prototypes ====================
+
+char *simRun(const char *options, const char *trace, int *status = 0);
+long simFind(const char *output, const char *event, unsigned long from = 0);
+unsigned long simCount(const char *output, const char *event, unsigned long from = 0, unsigned long to = (unsigned long)-1);
+double simValue(const char *output, const char *key);
+
+#endif
@@ -0,0 +1,147 @@
+//==================== Includes ====================
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "../../lib/Arduino_SK6812/SK6812_timing.h"
+
+/*
+  SK6812Encoder bit for bit: the symbol bytes it writes are compared with
+  a reference that builds the waveform one symbol at a time, for the
+  250 ns symbols of SK6812Usart at 16 MHz and for other symbol times
+  that fit the timing, and decoded back into pulses that must stay within
+  w_tolerance of the data sheet times.
+*/
+
+//==================== Defines ====================
+
+/*Longest data of the tests, a frame of 20 pixels*/
+#define DATA_MAX 80
+
+/*Written behind the symbols, encode() must leave it alone*/
+#define GUARD 0xA5
+
+//==================== Function Prototypes ====================
+
+template <uint16_t symbol_ns>
+void checkEncoder();
+uint16_t reference(const uint8_t *data, uint16_t length, uint8_t zero, uint8_t one, uint8_t period, uint8_t *symbols);
+void checkPulses(const uint8_t *data, uint16_t length, const uint8_t *symbols, uint16_t symbol_ns, uint8_t period);
+
+//==================== Tests ====================
+
+//USART1 at F_CPU / 4: a 0 is 10000, a 1 is 11110, MSB first, worked out by hand
+void test_usart_vectors()
+{
+  typedef SK6812Encoder<250> encoder_t;
+  const uint8_t data[] = {0x80, 0x00, 0xFF};
+  const uint8_t expected[] = {
+    0xF4, 0x21, 0x08, 0x42, 0x10,
+    0x84, 0x21, 0x08, 0x42, 0x10,
+    0xF7, 0xBD, 0xEF, 0x7B, 0xDE};
+  uint8_t symbols[sizeof(expected) + 1];
+
+  TEST_ASSERT_EQUAL(1, encoder_t::zero);
+  TEST_ASSERT_EQUAL(4, encoder_t::one);
+  TEST_ASSERT_EQUAL(5, encoder_t::period);
+
+  memset(symbols, GUARD, sizeof(symbols));
+  TEST_ASSERT_EQUAL(sizeof(expected), encoder_t::size(sizeof(data)));
+  TEST_ASSERT_EQUAL(sizeof(expected), encoder_t::encode(data, sizeof(data), symbols));
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, symbols, sizeof(expected));
+  TEST_ASSERT_EQUAL_HEX8(GUARD, symbols[sizeof(expected)]);
+}
+
+void test_usart_random()
+{
+  checkEncoder<250>();
+}
+
+//Other clocks: 4, 6 and 8 symbols per bit, the last one fills a symbol byte per bit
+void test_other_symbol_times()
+{
+  checkEncoder<300>();
+  checkEncoder<200>();
+  checkEncoder<160>();
+}
+
+//==================== Helpers ====================
+
+//Encodes random data of every length up to DATA_MAX and compares with the reference
+template <uint16_t symbol_ns>
+void checkEncoder()
+{
+  typedef SK6812Encoder<symbol_ns> encoder_t;
+  static uint8_t data[DATA_MAX];
+  static uint8_t symbols[DATA_MAX * 8 + 1];
+  static uint8_t expected[DATA_MAX * 8];
+
+  srand(symbol_ns);
+  for (uint16_t length = 1; length <= DATA_MAX; length++)
+  {
+    for (uint16_t i = 0; i < length; i++) data[i] = rand();
+
+    uint16_t size = reference(data, length, encoder_t::zero, encoder_t::one, encoder_t::period, expected);
+    memset(symbols, GUARD, sizeof(symbols));
+
+    TEST_ASSERT_EQUAL(size, encoder_t::size(length));
+    TEST_ASSERT_EQUAL(size, encoder_t::encode(data, length, symbols));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, symbols, size);
+    TEST_ASSERT_EQUAL_HEX8(GUARD, symbols[size]);
+    checkPulses(data, length, symbols, symbol_ns, encoder_t::period);
+  }
+}
+
+//Writes the waveform symbol by symbol: per bit zero or one symbols high, the rest of period low
+uint16_t reference(const uint8_t *data, uint16_t length, uint8_t zero, uint8_t one, uint8_t period, uint8_t *symbols)
+{
+  uint32_t symbol = 0;
+
+  memset(symbols, 0, ((uint32_t)length * 8 * period + 7) / 8);
+  for (uint32_t bit = 0; bit < (uint32_t)length * 8; bit++)
+  {
+    uint8_t high = data[bit / 8] & 0x80 >> bit % 8 ? one : zero;
+
+    for (uint8_t s = 0; s < period; s++, symbol++)
+      if(s < high) symbols[symbol / 8] |= 0x80 >> symbol % 8;
+  }
+  return (symbol + 7) / 8;
+}
+
+//Decodes the symbols into pulses: every bit starts high, its high time tells the value, all within tolerance
+void checkPulses(const uint8_t *data, uint16_t length, const uint8_t *symbols, uint16_t symbol_ns, uint8_t period)
+{
+  TEST_ASSERT_UINT_WITHIN(w_tolerance, w_totalperiod, period * symbol_ns);
+
+  for (uint32_t bit = 0; bit < (uint32_t)length * 8; bit++)
+  {
+    uint8_t high = 0;
+    for (uint32_t symbol = bit * period; symbol < (bit + 1) * period; symbol++)
+    {
+      if(!(symbols[symbol / 8] & 0x80 >> symbol % 8)) break;
+      high++;
+    }
+
+    bool one = data[bit / 8] & 0x80 >> bit % 8;
+    TEST_ASSERT_UINT_WITHIN(w_tolerance, one ? w_onepulse : w_zeropulse, high * symbol_ns);
+    TEST_ASSERT_LESS_THAN(period, high);
+  }
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_usart_vectors);
+  RUN_TEST(test_usart_random);
+  RUN_TEST(test_other_symbol_times);
+  return UNITY_END();
+}
@@ -0,0 +1,166 @@
+//==================== Includes ====================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "eventLog.h"
+#include "frame.h"
+#include "simRun.h"
+
+/*
+  Event records as sent in FRAME_EVENTS frames by the simulator: every
+  record carries all bytes of its UID, so Tags with 7 or 10 byte UIDs
+  that share the first four bytes are told apart in the log, and each
+  frame is exactly as long as its records.
+*/
+
+//==================== Defines ====================
+
+/*Strangers, denied once keying timed out, apart by more than a deny pattern*/
+#define PROBE_START 14000
+#define PROBE_GAP 2000
+
+/*Two 7 byte UIDs with the same first four bytes, and a 10 byte one starting alike*/
+#define UID_DOUBLE_A "04A1B2C3D4E5F6"
+#define UID_DOUBLE_B "04A1B2C3112233"
+#define UID_TRIPLE "04A1B2C3D4E5F6778899"
+
+#define RECORDS_MAX 32
+
+//==================== Objects ====================
+
+/*struct for a decoded record*/
+typedef struct
+{
+  unsigned long time;
+  unsigned char event;
+  unsigned char size;
+  unsigned char reader;
+  char uid[2 * UID_MAX_SIZE + 1];   // Hex of the UID bytes, of the head if size is 0
+} record_t;
+
+//==================== Global Variables ====================
+
+record_t records[RECORDS_MAX];
+unsigned int recordCount;
+
+//==================== Function Prototypes ====================
+
+void logRun(const char **probes, unsigned int probeCount);
+const record_t *logFind(unsigned char event, unsigned int nth);
+
+//==================== Tests ====================
+
+//Denials of long UIDs with the same head are logged with all their bytes
+void test_long_uids_apart()
+{
+  const char *probes[] = {UID_DOUBLE_A, UID_DOUBLE_B, UID_TRIPLE};
+  logRun(probes, 3);
+
+  for (unsigned int i = 0; i < 3; i++)
+  {
+    const record_t *record = logFind(EVENT_DENY, i);
+
+    TEST_ASSERT_NOT_NULL(record);
+    TEST_ASSERT_EQUAL(strlen(probes[i]) / 2, record->size);
+    TEST_ASSERT_EQUAL_STRING(probes[i], record->uid);
+    TEST_ASSERT_EQUAL(0, record->reader);
+  }
+  TEST_ASSERT_NULL(logFind(EVENT_DENY, 3));
+}
+
+//A 4 byte UID takes 4 bytes, the Master registered first
+void test_short_uid()
+{
+  logRun(0, 0);
+
+  const record_t *record = logFind(EVENT_MASTER_SET, 0);
+  TEST_ASSERT_NOT_NULL(record);
+  TEST_ASSERT_EQUAL(4, record->size);
+  TEST_ASSERT_EQUAL_STRING(SIM_RUN_MASTER, record->uid);
+}
+
+//==================== Helpers ====================
+
+//Registers the Master, badges each probe and decodes the records of all event frames
+void logRun(const char **probes, unsigned int probeCount)
+{
+  static char trace[1024];
+  unsigned long time = PROBE_START;
+  int length = snprintf(trace, sizeof(trace), "%s", SIM_RUN_MASTER_TRACE);
+  int status;
+
+  for (unsigned int i = 0; i < probeCount; i++, time += PROBE_GAP)
+    length += snprintf(&trace[length], sizeof(trace) - length, "%lu tag %s\n%lu none\n", time, probes[i], time + 200);
+  snprintf(&trace[length], sizeof(trace) - length, "%lu end\n", time + EVENTLOG_FLUSH_AGE + 100);
+
+  char *output = simRun("", trace, &status);
+  char prefix[16];
+
+  TEST_ASSERT_EQUAL(0, status);
+  recordCount = 0;
+  snprintf(prefix, sizeof(prefix), " serial %02X%02X", FRAME_SYNC, FRAME_EVENTS);
+  for (const char *line = strstr(output, prefix); line; line = strstr(line + 1, prefix))
+  {
+    const char *hex = line + strlen(prefix);
+    unsigned char payload[FRAME_PAYLOAD_MAX];
+    unsigned int size;
+
+    TEST_ASSERT_EQUAL(1, sscanf(hex, "%2x", &size));
+    for (unsigned int i = 0; i < size; i++)
+    {
+      unsigned int value;
+      TEST_ASSERT_EQUAL(1, sscanf(&hex[2 * (i + 1)], "%2x", &value));
+      payload[i] = value;
+    }
+
+    // Records follow sequence and dropped, each as long as its UID
+    unsigned int offset = 3;
+    while (offset < size)
+    {
+      record_t *record = &records[recordCount];
+      unsigned char *bytes = &payload[offset];
+
+      TEST_ASSERT_LESS_THAN(RECORDS_MAX, recordCount);
+      TEST_ASSERT_LESS_OR_EQUAL(size, offset + EVENTLOG_RECORD_HEADER);
+      record->time = bytes[0] | bytes[1] << 8 | (unsigned long)bytes[2] << 16 | (unsigned long)bytes[3] << 24;
+      record->event = bytes[4] & 0x0F;
+      record->size = bytes[4] >> 4;
+      record->reader = bytes[6];
+
+      unsigned char uidSize = record->size != 0 ? record->size : 4;
+      TEST_ASSERT_LESS_OR_EQUAL(size, offset + EVENTLOG_RECORD_HEADER + uidSize);
+      for (unsigned char i = 0; i < uidSize; i++) snprintf(&record->uid[2 * i], 3, "%02X", bytes[EVENTLOG_RECORD_HEADER + i]);
+
+      offset += EVENTLOG_RECORD_HEADER + uidSize;
+      recordCount++;
+    }
+    TEST_ASSERT_EQUAL(size, offset);
+  }
+  free(output);
+}
+
+//Returns the nth record of an event, 0 if there are fewer
+const record_t *logFind(unsigned char event, unsigned int nth)
+{
+  for (unsigned int i = 0; i < recordCount; i++)
+    if (records[i].event == event && nth-- == 0) return &records[i];
+  return 0;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_long_uids_apart);
+  RUN_TEST(test_short_uid);
+  return UNITY_END();
+}
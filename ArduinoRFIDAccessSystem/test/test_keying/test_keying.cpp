@@ -0,0 +1,99 @@
+//==================== Includes ====================
+
+#include <stdlib.h>
+#include <unity.h>
+#include "simRun.h"
+
+/*
+  Keying thresholds on the simulated clock: a member held for 5 s is
+  removed, the Master held for 10 s resets the Whitelist and for 13 s
+  everything. The times come from the millisecond clock of the Timer1
+  tick, so they hold whatever the loop spends per pass; the load runs
+  make every reader call slower until a poll with a Tag takes longer
+  than a tick.
+*/
+
+//==================== Defines ====================
+
+/*Main loop period in ms*/
+#define TICK 10
+
+/*Thresholds in ms, see KEYING_REMOVE_TIME, KEYING_RESET_WHITELIST_TIME and KEYING_RESET_MASTER_TIME*/
+#define REMOVE_TIME 5000
+#define RESET_WHITELIST_TIME 10000
+#define RESET_MASTER_TIME 13000
+
+/*Every threshold pattern starts with the buzzer, the Whitelist reset plays for 770 ms*/
+#define BUZZER_ON "tone 14 3000"
+#define RESET_WHITELIST_PATTERN 770
+
+/*Member added, held to remove it, then the Master held through both resets, keying stays open*/
+#define MEMBER "01020304"
+#define MEMBER_ARRIVAL 3000
+#define MASTER_ARRIVAL 10000
+#define KEYING_TRACE SIM_RUN_MASTER_TRACE "2000 tag " MEMBER "\n2200 none\n" \
+  "3000 tag " MEMBER "\n9000 none\n10000 tag " SIM_RUN_MASTER " master\n24000 none\n25000 end\n"
+
+//==================== Function Prototypes ====================
+
+void checkThresholds(const char *options);
+void checkThreshold(const char *output, unsigned long quiet, unsigned long threshold);
+
+//==================== Tests ====================
+
+void test_thresholds()
+{
+  checkThresholds("");
+}
+
+//SPI register accesses of 100 us and RF frames of 3 ms, about 5 ms per poll with a Tag
+void test_thresholds_loaded()
+{
+  checkThresholds("-s 100 -r 3000");
+}
+
+//SPI register accesses of 200 us and RF frames of 5 ms, polls with a Tag overrun the tick
+void test_thresholds_overloaded()
+{
+  checkThresholds("-s 200 -r 5000");
+}
+
+//==================== Helpers ====================
+
+//Runs the keying trace and checks each threshold
+void checkThresholds(const char *options)
+{
+  int status;
+  char *output = simRun(options, KEYING_TRACE, &status);
+
+  TEST_ASSERT_EQUAL(0, status);
+  checkThreshold(output, MEMBER_ARRIVAL + TICK, MEMBER_ARRIVAL + REMOVE_TIME);
+  checkThreshold(output, MASTER_ARRIVAL + TICK, MASTER_ARRIVAL + RESET_WHITELIST_TIME);
+  checkThreshold(output, MASTER_ARRIVAL + RESET_WHITELIST_TIME + RESET_WHITELIST_PATTERN + 2 * TICK, MASTER_ARRIVAL + RESET_MASTER_TIME);
+  free(output);
+}
+
+//The pattern of a threshold starts within two ticks of it, the buzzer is silent from quiet on until then
+void checkThreshold(const char *output, unsigned long quiet, unsigned long threshold)
+{
+  // The present time counts from the last poll without the Tag, up to a tick before it arrived
+  TEST_ASSERT_EQUAL(0, simCount(output, BUZZER_ON, quiet, threshold - 2 * TICK));
+  TEST_ASSERT_UINT_WITHIN(2 * TICK, threshold, simFind(output, BUZZER_ON, threshold - 2 * TICK));
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_thresholds);
+  RUN_TEST(test_thresholds_loaded);
+  RUN_TEST(test_thresholds_overloaded);
+  return UNITY_END();
+}
@@ -0,0 +1,171 @@
+//==================== Includes ====================
+
+#include <stdio.h>
+#include <time.h>
+#include <unity.h>
+#include "hal.h"
+#include "tagUID.h"
+#include "framTable.h"
+#include "store.h"
+
+/*
+  Whitelist lookup of the RAM hash table that replaced the linear scan,
+  filled to the default WHITELIST_SIZE (100 members in 128 slots) and to
+  the most members the EEPROM store admits in any build (124, a larger
+  WHITELIST_SIZE stops the build), next to what the scan cost at the same
+  count: half the list for a member, all of it for a stranger.
+
+  The FRAM table of WHITELIST_FRAM builds is filled to 100, 500 and 2000
+  members; the old list never held more than 100, so these runs only show
+  that its probes stay flat as it grows. Both tables run in this process,
+  without setup(). Costs are counted where the device spends its time,
+  in slots or FRAM pages probed; host times are only printed, they say
+  little about the ATmega.
+*/
+
+//==================== Defines ====================
+
+/*Lookups of members and strangers per count*/
+#define LOOKUPS 2000
+
+/*Members of a full RAM table: a store slot each, one for the Master and the reserve*/
+#define RAM_TABLE_FULL (STORE_SLOTS - 1 - STORE_RESERVE)
+
+/*The RAM hash table is built unless the Whitelist lives in FRAM or is indexed*/
+#if !defined(WHITELIST_INDEX) && !defined(WHITELIST_FRAM)
+#define RAM_TABLE
+#endif
+
+//==================== Function Prototypes ====================
+
+bool isWhitelistMember(const tagUID_t *UID);
+bool whitelistInsert(const tagUID_t *UID);
+void whitelistClear();
+unsigned long simCounter(unsigned char counter);
+
+bool tableInsert(const tagUID_t *UID, bool fram);
+tagUID_t testUID(unsigned long number);
+void lookupRun(unsigned int members, bool fram, double memberMax, double strangerMax);
+double hostNs(const struct timespec *start);
+
+//==================== Tests ====================
+
+#ifdef RAM_TABLE
+//78% of the slots, most strangers are turned away by the Bloom filter
+void test_ram_table_100()
+{
+  lookupRun(100, 0, 3, 1);
+}
+
+//97% of the slots, members sit in long clusters but cost a fraction of the scan
+void test_ram_table_full()
+{
+  lookupRun(RAM_TABLE_FULL, 0, 6, 1.5);
+}
+#endif
+
+//At most 20% of the FRAM table, a page read per lookup whatever the count
+void test_fram_table_100()
+{
+  lookupRun(100, 1, 1.1, 1.1);
+}
+
+void test_fram_table_500()
+{
+  lookupRun(500, 1, 1.1, 1.1);
+}
+
+void test_fram_table_2000()
+{
+  lookupRun(2000, 1, 1.1, 1.1);
+}
+
+//==================== Helpers ====================
+
+//Adds members to a table, looks up members and strangers and checks the slots or pages probed per lookup
+void lookupRun(unsigned int members, bool fram, double memberMax, double strangerMax)
+{
+  unsigned long probed[2] = {0};  // Members, strangers
+  char message[200];
+
+  if(fram) framTableFormat();
+  else whitelistClear();
+
+  for (unsigned int i = 0; i < members; i++)
+  {
+    tagUID_t UID = testUID(i);
+    TEST_ASSERT_TRUE(tableInsert(&UID, fram));
+  }
+
+  // Every second lookup a member, strangers are numbered after them
+  struct timespec start;
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (unsigned long i = 0; i < LOOKUPS; i++)
+  {
+    tagUID_t UID = testUID(i % 2 ? members + i : i % members);
+    unsigned long probes = simCounter(HAL_COUNT_PROBE);
+
+    TEST_ASSERT_EQUAL(i % 2 == 0, fram ? framTableFind(&UID) : isWhitelistMember(&UID));
+    probed[i % 2] += simCounter(HAL_COUNT_PROBE) - probes;
+  }
+  double tableNs = hostNs(&start);
+
+  double perMember = 2.0 * probed[0] / LOOKUPS;
+  double perStranger = 2.0 * probed[1] / LOOKUPS;
+  int length = snprintf(message, sizeof(message), "%s %u members: probes %.2f / %.2f (member / stranger), host ns %.0f",
+    fram ? "fram" : "ram", members, perMember, perStranger, tableNs / LOOKUPS);
+  if(!fram) snprintf(&message[length], sizeof(message) - length, "; the linear scan compared %.1f / %u", members / 2.0, members);
+  TEST_MESSAGE(message);
+
+  TEST_ASSERT_TRUE_MESSAGE(perMember < memberMax, message);
+  TEST_ASSERT_TRUE_MESSAGE(perStranger < strangerMax, message);
+}
+
+//Adds a UID to the FRAM or the RAM table, returns 0 if it is full
+bool tableInsert(const tagUID_t *UID, bool fram)
+{
+#ifdef RAM_TABLE
+  if(!fram) return whitelistInsert(UID);
+#endif
+  return framTableInsert(UID);
+}
+
+//Returns a 4 byte UID for a number, members count from 0, strangers follow
+tagUID_t testUID(unsigned long number)
+{
+  unsigned long head = (number + 1) * 2654435761UL ^ 0x5EED;
+  unsigned char bytes[4] = {(unsigned char)(head >> 24), (unsigned char)(head >> 16), (unsigned char)(head >> 8), (unsigned char)head};
+  tagUID_t UID;
+
+  uidSet(&UID, bytes, sizeof(bytes));
+  return UID;
+}
+
+//Returns the host time since start in ns
+double hostNs(const struct timespec *start)
+{
+  struct timespec stop;
+  clock_gettime(CLOCK_MONOTONIC, &stop);
+  return (stop.tv_sec - start->tv_sec) * 1e9 + (stop.tv_nsec - start->tv_nsec);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+#ifdef RAM_TABLE
+  RUN_TEST(test_ram_table_100);
+  RUN_TEST(test_ram_table_full);
+#endif
+  RUN_TEST(test_fram_table_100);
+  RUN_TEST(test_fram_table_500);
+  RUN_TEST(test_fram_table_2000);
+  return UNITY_END();
+}
@@ -0,0 +1,142 @@
+//==================== Includes ====================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unity.h>
+#include "store.h"
+#include "simRun.h"
+
+/*
+  EEPROM cells written per Whitelist change: each add, remove and reset
+  appends one store record (two for UIDs longer than 5 bytes) instead of
+  rewriting the Whitelist, also over many changes with the compaction the
+  store does when it wraps. The counts are the simulator's "eeprom bytes
+  written" from a mark line on, unchanged cells are not written. The
+  WHITELIST_FRAM build keeps the members in FRAM, there only the add
+  latency is checked.
+*/
+
+//==================== Defines ====================
+
+/*Output lines and statistics of the simulator*/
+#define BUZZER_ON "tone 14 3000"
+#define WRITTEN "eeprom bytes written "
+
+/*Member and long UID added while keying is open*/
+#define MEMBER "01020304"
+#define MEMBER_LONG "04A1B2C3D4E5F6"
+
+/*Add and remove cycles of the churn test, about three times around the store*/
+#define CHURN_CYCLES 180
+
+//==================== Function Prototypes ====================
+
+double written(const char *trace);
+
+//==================== Tests ====================
+
+#ifndef WHITELIST_FRAM
+void test_add_writes_one_record()
+{
+  TEST_ASSERT_EQUAL(STORE_SLOT_SIZE, written(SIM_RUN_MASTER_TRACE "1500 mark\n2000 tag " MEMBER "\n2200 none\n3000 end\n"));
+}
+
+void test_add_long_uid_writes_two_records()
+{
+  double cells = written(SIM_RUN_MASTER_TRACE "1500 mark\n2000 tag " MEMBER_LONG "\n2200 none\n3000 end\n");
+
+  TEST_ASSERT_GREATER_THAN(STORE_SLOT_SIZE, cells);
+  TEST_ASSERT_LESS_OR_EQUAL(2 * STORE_SLOT_SIZE, cells);
+}
+
+//The member is held for 5 s while keying to remove it
+void test_remove_writes_one_record()
+{
+  TEST_ASSERT_EQUAL(STORE_SLOT_SIZE, written(SIM_RUN_MASTER_TRACE "2000 tag " MEMBER "\n2200 none\n"
+    "15000 tag " SIM_RUN_MASTER " master\n15250 none\n15500 mark\n16000 tag " MEMBER "\n22000 none\n23000 end\n"));
+}
+
+//The Master is held for 10 s while keying to clear the Whitelist
+void test_reset_writes_one_record()
+{
+  TEST_ASSERT_EQUAL(STORE_SLOT_SIZE, written(SIM_RUN_MASTER_TRACE "2000 tag " MEMBER "\n2200 none\n2500 tag " MEMBER_LONG "\n2700 none\n"
+    "2900 mark\n3000 tag " SIM_RUN_MASTER " master\n14000 none\n15000 end\n"));
+}
+#endif
+
+//The add is signalled as soon as its record is written, milliseconds after the Tag left
+void test_add_latency()
+{
+  char *output = simRun("", SIM_RUN_MASTER_TRACE "2000 tag " MEMBER "\n2200 none\n3000 end\n");
+
+  // Leaving is noticed after the presence debounce of 60 ms, then 8 cells of 3.4 ms
+  long signal = simFind(output, BUZZER_ON, 2200);
+  TEST_ASSERT_GREATER_OR_EQUAL(2200, signal);
+  TEST_ASSERT_LESS_THAN(2200 + 60 + 20 + STORE_SLOT_SIZE * 4, signal);
+  free(output);
+}
+
+#ifndef WHITELIST_FRAM
+//Adding and removing a member over and over wraps the store several times, each change still costs about one record
+void test_churn_compaction()
+{
+  static char trace[64 * CHURN_CYCLES + 256];
+  unsigned long time = 2000;
+  int length = snprintf(trace, sizeof(trace), "%s1500 mark\n", SIM_RUN_MASTER_TRACE);
+
+  // Tap to add, hold 5.5 s to remove; keying stays open while Tags come
+  for (unsigned int cycle = 0; cycle < CHURN_CYCLES; cycle++, time += 6600)
+  {
+    length += snprintf(&trace[length], sizeof(trace) - length, "%lu tag " MEMBER "\n%lu none\n%lu tag " MEMBER "\n%lu none\n",
+      time, time + 200, time + 600, time + 6100);
+  }
+  snprintf(&trace[length], sizeof(trace) - length, "%lu end\n", time + 1000);
+
+  char *output = simRun("", trace);
+  double perChange = simValue(output, WRITTEN) / (2 * CHURN_CYCLES);
+
+  // One beep per add, three per removal
+  TEST_ASSERT_EQUAL(4 * CHURN_CYCLES, simCount(output, BUZZER_ON, 1500));
+  TEST_ASSERT_GREATER_THAN(STORE_SLOTS, 2 * CHURN_CYCLES);
+  TEST_ASSERT_TRUE(perChange <= STORE_SLOT_SIZE + 0.5);
+  free(output);
+}
+#endif
+
+//==================== Helpers ====================
+
+//Returns the EEPROM cells written by a trace from its mark line on
+double written(const char *trace)
+{
+  int status;
+  char *output = simRun("-q", trace, &status);
+  double cells = simValue(output, WRITTEN);
+
+  TEST_ASSERT_EQUAL(0, status);
+  free(output);
+  return cells;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+#ifndef WHITELIST_FRAM
+  RUN_TEST(test_add_writes_one_record);
+  RUN_TEST(test_add_long_uid_writes_two_records);
+  RUN_TEST(test_remove_writes_one_record);
+  RUN_TEST(test_reset_writes_one_record);
+#endif
+  RUN_TEST(test_add_latency);
+#ifndef WHITELIST_FRAM
+  RUN_TEST(test_churn_compaction);
+#endif
+  return UNITY_END();
+}
@@ -0,0 +1,217 @@
+//==================== Includes ====================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <unity.h>
+#include "framTable.h"
+#include "simRun.h"
+
+/*
+  Power loss in the middle of store writes: the simulator's -p option cuts
+  the power after every cell write of a run, boots each image and checks
+  that the store brings back Master and Whitelist from before or after
+  the interrupted append (see src/hal_native.cpp). Runs random traces with
+  provisioning and resets, and a member added and removed until the store
+  has wrapped several times, so compaction copies are cut as well, and
+  the one-time conversion of a full EEPROM of the fixed-address layout
+  that came before the store, cut anywhere in setup(); with WHITELIST_FRAM
+  the new FRAM table is then filled from the store, cut after every
+  transfer as well.
+*/
+
+//==================== Defines ====================
+
+/*Random traces, their steps*/
+#define SEEDS 3
+#define STEPS 300
+
+/*Add and remove cycles, about three times around the store*/
+#define CHURN_CYCLES 180
+
+/*Boot with a full store reads all slots, a few ms*/
+#define RECOVERY_MAX_US 10000
+
+/*Fixed-address layout: Master and a list of 100 heads, least significant byte first*/
+#define LEGACY_MASTER 0x010
+#define LEGACY_WHITELIST 0x020
+#define LEGACY_SIZE 100
+#define LEGACY_IMAGE_SIZE 1024
+
+/*Conversion of the legacy image writes most of the EEPROM, tags are presented after it, apart by more than OPEN_TIME*/
+#define LEGACY_BOOT 5000
+#define LEGACY_PROBE_GAP 4000
+
+/*Members of the legacy image: the first and last of the upper store slots, of the lower ones, the last one*/
+#define LEGACY_MEMBER(i) (0x11000000UL + (i))
+#define LEGACY_PROBES {0, 71, 72, 98, 99}
+
+//==================== Objects ====================
+
+/*struct for the statistics of a run with power cuts*/
+typedef struct
+{
+  unsigned long cuts;
+  unsigned long before;
+  unsigned long after;
+  unsigned long failed;
+  unsigned long recoveryMax;
+  unsigned long slotMin;
+  unsigned long slotMax;
+  double slotMean;
+} cutStats_t;
+
+//==================== Function Prototypes ====================
+
+cutStats_t cutRun(const char *options, const char *trace);
+void cutCheck(const cutStats_t *stats);
+void legacyImage(const char *path);
+
+//==================== Tests ====================
+
+void test_random_traces()
+{
+  for (unsigned int seed = 1; seed <= SEEDS; seed++)
+  {
+    char options[64];
+    snprintf(options, sizeof(options), "-q -x %u -n %u -p 1", seed, STEPS);
+
+    cutStats_t stats = cutRun(options, "");
+    cutCheck(&stats);
+  }
+}
+
+//Compaction copies live records forward, cuts in between must not lose or revive members
+void test_churn_with_compaction()
+{
+  static char trace[64 * CHURN_CYCLES + 256];
+  unsigned long time = 2000;
+  int length = snprintf(trace, sizeof(trace), "%s1500 tag 0A0B0C0D\n1700 none\n", SIM_RUN_MASTER_TRACE);
+
+  for (unsigned int cycle = 0; cycle < CHURN_CYCLES; cycle++, time += 6600)
+  {
+    length += snprintf(&trace[length], sizeof(trace) - length, "%lu tag 01020304\n%lu none\n%lu tag 01020304\n%lu none\n",
+      time, time + 200, time + 600, time + 6100);
+  }
+  snprintf(&trace[length], sizeof(trace) - length, "%lu end\n", time + 1000);
+
+  cutStats_t stats = cutRun("-q -p 1", trace);
+  cutCheck(&stats);
+
+  // Writes rotate through all slots, none is written twice as often as another; with WHITELIST_FRAM only the Master is stored
+#ifndef WHITELIST_FRAM
+  TEST_ASSERT_GREATER_THAN(0, stats.slotMin);
+  TEST_ASSERT_LESS_OR_EQUAL(2 * stats.slotMin, stats.slotMax);
+#endif
+}
+
+//Conversion writes around the cells it reads and the magic last, a cut boot starts over where it is safe
+void test_legacy_conversion()
+{
+  char path[] = "/tmp/test_power_lossXXXXXX";
+  char options[64];
+  int status;
+
+  close(mkstemp(path));
+  legacyImage(path);
+  snprintf(options, sizeof(options), "-q -p 1 %s", path);
+  cutStats_t stats = cutRun(options, "1000 end\n");
+
+  TEST_ASSERT_EQUAL(0, stats.failed);
+  TEST_ASSERT_EQUAL(stats.cuts, stats.before + stats.after);
+  TEST_ASSERT_GREATER_THAN(LEGACY_SIZE, stats.cuts);
+#ifdef WHITELIST_FRAM
+  // Formatting the table alone writes every page header
+  TEST_ASSERT_GREATER_THAN(FRAM_PAGES + LEGACY_SIZE, stats.cuts);
+#endif
+
+  // Uncut, the conversion brings every member, and the Master: without one the Whitelist would be reset
+  static char trace[512];
+  const unsigned int probes[] = LEGACY_PROBES;
+  unsigned long time = LEGACY_BOOT;
+  int length = 0;
+
+  for (unsigned int i = 0; i < sizeof(probes) / sizeof(probes[0]); i++, time += LEGACY_PROBE_GAP)
+    length += snprintf(&trace[length], sizeof(trace) - length, "%lu tag %08lX\n%lu none\n", time, LEGACY_MEMBER(probes[i]), time + 200);
+  snprintf(&trace[length], sizeof(trace) - length, "%lu end\n", time);
+
+  legacyImage(path);
+  snprintf(options, sizeof(options), "%s", path);
+  char *output = simRun(options, trace, &status);
+  unlink(path);
+
+  TEST_ASSERT_EQUAL(0, status);
+  TEST_ASSERT_EQUAL(sizeof(probes) / sizeof(probes[0]), simCount(output, "pin 17 high"));
+  free(output);
+}
+
+//==================== Helpers ====================
+
+//Writes a full EEPROM of the fixed-address layout to path
+void legacyImage(const char *path)
+{
+  unsigned char image[LEGACY_IMAGE_SIZE];
+  unsigned long master = strtoul(SIM_RUN_MASTER, 0, 16);
+
+  memset(image, 0xFF, sizeof(image));
+  for (unsigned char i = 0; i < 4; i++) image[LEGACY_MASTER + i] = master >> (8 * i);
+  for (unsigned int member = 0; member < LEGACY_SIZE; member++)
+    for (unsigned char i = 0; i < 4; i++) image[LEGACY_WHITELIST + 4 * member + i] = LEGACY_MEMBER(member) >> (8 * i);
+
+  int file = open(path, O_WRONLY | O_TRUNC);
+  TEST_ASSERT_TRUE(file >= 0);
+  TEST_ASSERT_EQUAL(sizeof(image), write(file, image, sizeof(image)));
+  close(file);
+}
+
+//Runs the simulator with power cuts and reads its statistics
+cutStats_t cutRun(const char *options, const char *trace)
+{
+  cutStats_t stats = {0};
+  int status;
+  char *output = simRun(options, trace, &status);
+
+  const char *cuts = strstr(output, "power cuts ");
+  const char *recovery = strstr(output, "recovery us ");
+  const char *wear = strstr(output, "eeprom cell writes per store slot ");
+
+  TEST_ASSERT_EQUAL_MESSAGE(0, status, output);
+  TEST_ASSERT_NOT_NULL(cuts);
+  TEST_ASSERT_NOT_NULL(recovery);
+  TEST_ASSERT_NOT_NULL(wear);
+
+  TEST_ASSERT_EQUAL(4, sscanf(cuts, "power cuts %lu recovered before %lu after %lu failed %lu", &stats.cuts, &stats.before, &stats.after, &stats.failed));
+  TEST_ASSERT_EQUAL(1, sscanf(recovery, "recovery us mean %*f max %lu", &stats.recoveryMax));
+  TEST_ASSERT_EQUAL(3, sscanf(wear, "eeprom cell writes per store slot min %lu mean %lf max %lu", &stats.slotMin, &stats.slotMean, &stats.slotMax));
+  free(output);
+  return stats;
+}
+
+//Every cut recovered to one of both states, some to each, in a few ms
+void cutCheck(const cutStats_t *stats)
+{
+  TEST_ASSERT_EQUAL(0, stats->failed);
+  TEST_ASSERT_EQUAL(stats->cuts, stats->before + stats->after);
+  TEST_ASSERT_GREATER_THAN(0, stats->before);
+  TEST_ASSERT_GREATER_THAN(0, stats->after);
+  TEST_ASSERT_LESS_THAN(RECOVERY_MAX_US, stats->recoveryMax);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_random_traces);
+  RUN_TEST(test_churn_with_compaction);
+  RUN_TEST(test_legacy_conversion);
+  return UNITY_END();
+}
@@ -0,0 +1,188 @@
+//==================== Includes ====================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "hal.h"
+#include "simRun.h"
+
+/*
+  Tag presence detector replayed against recorded PICC responses: one
+  character per poll, 'A' where the Tag answered the WUPA with its ATQA,
+  '-' where the poll timed out, as seen with a card moved in and out of
+  the field of an MFRC522. Each recording is turned into tag and none
+  lines between two polls and run through the simulator. Dropouts shorter
+  than PRESENCE_DEBOUNCE are bridged, longer ones end the presence; every
+  poll is a single wake-up and every presence one deny pattern.
+*/
+
+//==================== Defines ====================
+
+/*Main loop period in ms, one poll per tick*/
+#define TICK 10
+
+/*Polls without answer that end a presence, PRESENCE_DEBOUNCE / TICK*/
+#define DROPOUT_POLLS 6
+
+/*Time the recordings start at, the Master is registered and keying closed*/
+#define REPLAY_START 14000
+
+/*A stranger, denied once per presence with four beeps, see patternPermDenied*/
+#define STRANGER "0A0B0C0D"
+#define BUZZER_ON "tone 14 3000"
+#define DENY_BEEPS 4
+
+/*One second without answers, longer than a deny pattern*/
+#define REC_SILENCE "----------------------------------------------------------------------------------------------------"
+
+/*Recordings: held steadily, at the fringe of the field, taken away and brought back*/
+#define REC_STEADY "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"
+#define REC_FRINGE "A-A--AAA---AAAAA-AAAA--A-----AAAAAAAAAAAA-AAAAAAAA--AAA----AAAA"
+#define REC_TWICE "AAAAAAAAAAAAAAAAAAAA" REC_SILENCE "AAAAAAAAAAAAAAAAAAAA"
+#define REC_PASSES "AAAA" REC_SILENCE "A-AA" REC_SILENCE "------AAAAAA"
+
+//==================== Objects ====================
+
+/*struct for the outcome of a replay*/
+typedef struct
+{
+  unsigned long denials;
+  unsigned long wakeups;
+  unsigned long selects;
+  long latency;                 // ms from arrival to the first beep
+  unsigned long polls;          // Length of the recording
+} replay_t;
+
+//==================== Function Prototypes ====================
+
+replay_t replay(const char *recording);
+unsigned int presences(const char *recording);
+
+//==================== Tests ====================
+
+//A steady Tag is one presence, decided in the poll after it arrived
+void test_steady()
+{
+  replay_t run = replay(REC_STEADY);
+
+  TEST_ASSERT_EQUAL(1, run.denials);
+  TEST_ASSERT_EQUAL(1, run.selects);
+  TEST_ASSERT_GREATER_OR_EQUAL(0, run.latency);
+  TEST_ASSERT_LESS_THAN(TICK, run.latency);
+}
+
+//Dropouts of up to five polls at the fringe of the field do not make the presence flicker
+void test_fringe()
+{
+  replay_t run = replay(REC_FRINGE);
+
+  TEST_ASSERT_EQUAL(1, presences(REC_FRINGE));
+  TEST_ASSERT_EQUAL(1, run.denials);
+  TEST_ASSERT_EQUAL(1, run.selects);
+  TEST_ASSERT_LESS_THAN(TICK, run.latency);
+}
+
+//Taken away for the debounce window and brought back, the Tag is decided again
+void test_twice()
+{
+  replay_t run = replay(REC_TWICE);
+
+  TEST_ASSERT_EQUAL(2, run.denials);
+  TEST_ASSERT_EQUAL(2, run.selects);
+}
+
+//Short passes through the field are each decided once
+void test_passes()
+{
+  replay_t run = replay(REC_PASSES);
+
+  TEST_ASSERT_EQUAL(3, presences(REC_PASSES));
+  TEST_ASSERT_EQUAL(3, run.denials);
+  TEST_ASSERT_EQUAL(3, run.selects);
+}
+
+//One radio round-trip per poll and reader, with or without a Tag
+void test_one_wakeup_per_poll()
+{
+  replay_t run = replay(REC_FRINGE);
+
+  // Counted from the mark line to the end line, one second after the recording
+  TEST_ASSERT_UINT_WITHIN(2 * HAL_READERS, HAL_READERS * (run.polls + 1000 / TICK), run.wakeups);
+}
+
+//==================== Helpers ====================
+
+//Replays a recording from REPLAY_START, one tag or none line in the middle of a tick per change
+replay_t replay(const char *recording)
+{
+  static char trace[8192];
+  replay_t run = {0};
+  int length = snprintf(trace, sizeof(trace), "%s%u mark\n", SIM_RUN_MASTER_TRACE, REPLAY_START - TICK / 2);
+  char last = '-';
+
+  run.polls = strlen(recording);
+  for (unsigned long poll = 0; poll < run.polls; last = recording[poll++])
+  {
+    if (recording[poll] == last) continue;
+
+    unsigned long time = REPLAY_START + poll * TICK - TICK / 2;
+    if (recording[poll] == 'A') length += snprintf(&trace[length], sizeof(trace) - length, "%lu tag " STRANGER "\n", time);
+    else length += snprintf(&trace[length], sizeof(trace) - length, "%lu none\n", time);
+  }
+  snprintf(&trace[length], sizeof(trace) - length, "%lu none\n%lu end\n",
+    REPLAY_START + run.polls * TICK - TICK / 2, REPLAY_START + run.polls * TICK - TICK / 2 + 1000);
+
+  int status;
+  char *output = simRun("", trace, &status);
+  const char *line = strstr(output, "reader wakeups ");
+
+  TEST_ASSERT_EQUAL(0, status);
+  TEST_ASSERT_NOT_NULL(line);
+  TEST_ASSERT_EQUAL(2, sscanf(line, "reader wakeups %lu selects %lu", &run.wakeups, &run.selects));
+
+  // The Tag arrived on the line of the first answer, half a tick before its poll
+  long arrival = REPLAY_START + (strchr(recording, 'A') - recording) * TICK - TICK / 2;
+  run.denials = simCount(output, BUZZER_ON, REPLAY_START) / DENY_BEEPS;
+  run.latency = simFind(output, BUZZER_ON, arrival) - arrival;
+  free(output);
+  return run;
+}
+
+//Returns the presences in a recording: runs of answers separated by DROPOUT_POLLS or more timeouts
+unsigned int presences(const char *recording)
+{
+  unsigned int count = 0;
+  unsigned int silent = DROPOUT_POLLS;
+
+  for (const char *poll = recording; *poll; poll++)
+  {
+    if (*poll != 'A')
+    {
+      silent++;
+      continue;
+    }
+    if (silent >= DROPOUT_POLLS) count++;
+    silent = 0;
+  }
+  return count;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_steady);
+  RUN_TEST(test_fringe);
+  RUN_TEST(test_twice);
+  RUN_TEST(test_passes);
+  RUN_TEST(test_one_wakeup_per_poll);
+  return UNITY_END();
+}
@@ -0,0 +1,298 @@
+//==================== Includes ====================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "crc8.h"
+#include "frame.h"
+#include "provision.h"
+#include "simRun.h"
+
+/*
+  Provisioning frames on the serial line of the simulator: a session of
+  valid frames, and frames the receiver has to drop, with a bad CRC, a
+  length beyond its buffer or cut off by silence, each followed by a valid
+  one. Every frame taken is acknowledged with its type, batch and status,
+  a dropped one is not; afterwards each UID is badged to check what made
+  it into the Whitelist.
+*/
+
+//==================== Defines ====================
+
+/*The Master opens keying, frames follow apart by more than FRAME_RX_GAP and are all in before it times out*/
+#define SESSION_TRACE "1000 tag " SIM_RUN_MASTER " master\n1300 none\n"
+#define FRAME_START 2000
+#define FRAME_GAP 500
+
+/*Tags are badged once keying timed out, apart by more than OPEN_TIME*/
+#define PROBE_START 16000
+#define PROBE_GAP 4000
+
+/*UIDs of 4, 7 and 10 bytes*/
+#define UID_SHORT "11223344"
+#define UID_DOUBLE "04A1B2C3D4E5F6"
+#define UID_TRIPLE "0455667788991A2B3C4D"
+#define UID_OTHER "55667788"
+
+#define ACKS_MAX 16
+
+/*Header of a frame longer than FRAME_RX_PAYLOAD_MAX*/
+#define HEADER_TOO_LONG "7E1140"
+
+/*Serial line hex of a frame*/
+#define FRAME_HEX_SIZE (2 * (FRAME_HEADER_SIZE + FRAME_RX_PAYLOAD_MAX + 1) + 1)
+
+//==================== Objects ====================
+
+/*struct for an acknowledge, see provision.h*/
+typedef struct
+{
+  unsigned char type;
+  unsigned char batch;
+  unsigned char status;
+  unsigned int applied;
+  unsigned int failed;
+} ack_t;
+
+/*struct for a session: its trace, then what the simulator answered*/
+typedef struct
+{
+  char trace[4096];
+  int length;
+  unsigned long time;           // Of the next frame
+  char *output;
+  ack_t acks[ACKS_MAX];
+  unsigned int ackCount;
+} session_t;
+
+//==================== Function Prototypes ====================
+
+void frameHex(char *hex, unsigned char type, const char *payload, unsigned char corrupt = 0, unsigned char cut = 0);
+void sessionBegin(session_t *session);
+void sessionFrame(session_t *session, unsigned char type, const char *payload, unsigned char corrupt = 0, unsigned char cut = 0);
+void sessionSerial(session_t *session, const char *hex);
+void sessionRun(session_t *session, const char **probes, unsigned int probeCount);
+bool sessionGranted(const session_t *session, unsigned int probe);
+void sessionEnd(session_t *session);
+void checkAck(const ack_t *ack, unsigned char type, unsigned char batch, unsigned char status, unsigned int applied, unsigned int failed);
+
+//==================== Tests ====================
+
+//Adds of every UID size and a remove, each frame acknowledged with the UIDs applied since begin
+void test_valid_frames()
+{
+  static session_t session;
+  const char *probes[] = {UID_SHORT, UID_DOUBLE, UID_TRIPLE, UID_OTHER};
+
+  sessionBegin(&session);
+  sessionFrame(&session, FRAME_PROVISION_BEGIN, "01");
+  sessionFrame(&session, FRAME_PROVISION_ADD, "01" "04" UID_SHORT "07" UID_DOUBLE "0A" UID_TRIPLE);
+  sessionFrame(&session, FRAME_PROVISION_REMOVE, "02" "07" UID_DOUBLE "04" UID_OTHER);
+  sessionFrame(&session, FRAME_PROVISION_END, "");
+  sessionRun(&session, probes, 4);
+
+  TEST_ASSERT_EQUAL(4, session.ackCount);
+  checkAck(&session.acks[0], FRAME_PROVISION_BEGIN, 0x01, PROVISION_OK, 0, 0);
+  checkAck(&session.acks[1], FRAME_PROVISION_ADD, 0x01, PROVISION_OK, 3, 0);
+  checkAck(&session.acks[2], FRAME_PROVISION_REMOVE, 0x02, PROVISION_OK, 4, 0);
+  checkAck(&session.acks[3], FRAME_PROVISION_END, 0x00, PROVISION_OK, 4, 0);
+
+  TEST_ASSERT_TRUE(sessionGranted(&session, 0));
+  TEST_ASSERT_FALSE(sessionGranted(&session, 1));
+  TEST_ASSERT_TRUE(sessionGranted(&session, 2));
+  TEST_ASSERT_FALSE(sessionGranted(&session, 3));
+  sessionEnd(&session);
+}
+
+//A frame with a wrong CRC is dropped without an answer, the next one is taken
+void test_bad_crc()
+{
+  static session_t session;
+  const char *probes[] = {UID_SHORT, UID_OTHER};
+
+  sessionBegin(&session);
+  sessionFrame(&session, FRAME_PROVISION_BEGIN, "00");
+  sessionFrame(&session, FRAME_PROVISION_ADD, "01" "04" UID_SHORT, 0x01);
+  sessionFrame(&session, FRAME_PROVISION_ADD, "02" "04" UID_OTHER);
+  sessionFrame(&session, FRAME_PROVISION_END, "");
+  sessionRun(&session, probes, 2);
+
+  TEST_ASSERT_EQUAL(3, session.ackCount);
+  checkAck(&session.acks[1], FRAME_PROVISION_ADD, 0x02, PROVISION_OK, 1, 0);
+  checkAck(&session.acks[2], FRAME_PROVISION_END, 0x00, PROVISION_OK, 1, 0);
+
+  TEST_ASSERT_FALSE(sessionGranted(&session, 0));
+  TEST_ASSERT_TRUE(sessionGranted(&session, 1));
+  sessionEnd(&session);
+}
+
+//A length beyond the receive buffer is dropped at the header, the frame right behind it is taken; a UID running past the payload rejects the whole batch
+void test_bad_length()
+{
+  static session_t session;
+  const char *probes[] = {UID_SHORT, UID_DOUBLE, UID_OTHER};
+  char hex[sizeof(HEADER_TOO_LONG) + FRAME_HEX_SIZE] = HEADER_TOO_LONG;
+
+  sessionBegin(&session);
+  sessionFrame(&session, FRAME_PROVISION_BEGIN, "00");
+  frameHex(&hex[strlen(hex)], FRAME_PROVISION_ADD, "01" "04" UID_SHORT);
+  sessionSerial(&session, hex);
+  sessionFrame(&session, FRAME_PROVISION_ADD, "02" "07" UID_DOUBLE "07" UID_OTHER);
+  sessionFrame(&session, FRAME_PROVISION_ADD, "03" "05" UID_OTHER "00");
+  sessionFrame(&session, FRAME_PROVISION_END, "");
+  sessionRun(&session, probes, 3);
+
+  TEST_ASSERT_EQUAL(5, session.ackCount);
+  checkAck(&session.acks[1], FRAME_PROVISION_ADD, 0x01, PROVISION_OK, 1, 0);
+  checkAck(&session.acks[2], FRAME_PROVISION_ADD, 0x02, PROVISION_MALFORMED, 1, 0);
+  checkAck(&session.acks[3], FRAME_PROVISION_ADD, 0x03, PROVISION_MALFORMED, 1, 0);
+
+  TEST_ASSERT_TRUE(sessionGranted(&session, 0));
+  TEST_ASSERT_FALSE(sessionGranted(&session, 1));
+  TEST_ASSERT_FALSE(sessionGranted(&session, 2));
+  sessionEnd(&session);
+}
+
+//A frame cut off is dropped after FRAME_RX_GAP of silence, the next frame is taken
+void test_truncated_frame()
+{
+  static session_t session;
+  const char *probes[] = {UID_SHORT, UID_OTHER};
+
+  sessionBegin(&session);
+  sessionFrame(&session, FRAME_PROVISION_BEGIN, "00");
+  sessionFrame(&session, FRAME_PROVISION_ADD, "01" "04" UID_SHORT, 0, 3);
+  sessionFrame(&session, FRAME_PROVISION_ADD, "02" "04" UID_OTHER);
+  sessionFrame(&session, FRAME_PROVISION_END, "");
+  sessionRun(&session, probes, 2);
+
+  TEST_ASSERT_EQUAL(3, session.ackCount);
+  checkAck(&session.acks[1], FRAME_PROVISION_ADD, 0x02, PROVISION_OK, 1, 0);
+
+  TEST_ASSERT_FALSE(sessionGranted(&session, 0));
+  TEST_ASSERT_TRUE(sessionGranted(&session, 1));
+  sessionEnd(&session);
+}
+
+//==================== Helpers ====================
+
+//Starts a trace that opens keying with the Master
+void sessionBegin(session_t *session)
+{
+  memset(session, 0, sizeof(*session));
+  session->length = snprintf(session->trace, sizeof(session->trace), "%s", SESSION_TRACE);
+  session->time = FRAME_START;
+}
+
+//Adds a frame to the session, see frameHex()
+void sessionFrame(session_t *session, unsigned char type, const char *payload, unsigned char corrupt, unsigned char cut)
+{
+  char hex[FRAME_HEX_SIZE];
+
+  frameHex(hex, type, payload, corrupt, cut);
+  sessionSerial(session, hex);
+}
+
+//Writes the hex of a frame with the payload given in hex, its CRC xored with corrupt, its last cut bytes left out
+void frameHex(char *hex, unsigned char type, const char *payload, unsigned char corrupt, unsigned char cut)
+{
+  unsigned char frame[FRAME_HEADER_SIZE + FRAME_RX_PAYLOAD_MAX + 1] = {FRAME_SYNC, type};
+  unsigned char length = strlen(payload) / 2;
+
+  TEST_ASSERT_TRUE(length <= FRAME_RX_PAYLOAD_MAX);
+  for (unsigned char i = 0; i < length; i++)
+  {
+    unsigned int value;
+    sscanf(&payload[2 * i], "%2x", &value);
+    frame[FRAME_HEADER_SIZE + i] = value;
+  }
+  frame[2] = length;
+  frame[FRAME_HEADER_SIZE + length] = crc8(&frame[1], length + FRAME_HEADER_SIZE - 1) ^ corrupt;
+
+  unsigned char size = FRAME_HEADER_SIZE + length + 1 - cut;
+  for (unsigned char i = 0; i < size; i++) snprintf(&hex[2 * i], 3, "%02X", frame[i]);
+  hex[2 * size] = 0;
+}
+
+//Adds raw bytes on the serial line at the time of the next frame
+void sessionSerial(session_t *session, const char *hex)
+{
+  session->length += snprintf(&session->trace[session->length], sizeof(session->trace) - session->length,
+    "%lu serial %s\n", session->time, hex);
+  session->time += FRAME_GAP;
+}
+
+//Badges each probe after the session, runs the trace and reads the acknowledges
+void sessionRun(session_t *session, const char **probes, unsigned int probeCount)
+{
+  unsigned long time = PROBE_START;
+  int status;
+
+  for (unsigned int i = 0; i < probeCount; i++, time += PROBE_GAP)
+    session->length += snprintf(&session->trace[session->length], sizeof(session->trace) - session->length,
+      "%lu tag %s\n%lu none\n", time, probes[i], time + 200);
+  snprintf(&session->trace[session->length], sizeof(session->trace) - session->length, "%lu end\n", time);
+  TEST_ASSERT_LESS_THAN(sizeof(session->trace) - 1, session->length);
+
+  session->output = simRun("", session->trace, &status);
+  TEST_ASSERT_EQUAL(0, status);
+
+  char prefix[16];
+  snprintf(prefix, sizeof(prefix), " serial %02X%02X%02X", FRAME_SYNC, FRAME_PROVISION_ACK, PROVISION_ACK_SIZE);
+  for (const char *line = strstr(session->output, prefix); line; line = strstr(line + 1, prefix))
+  {
+    unsigned int payload[PROVISION_ACK_SIZE];
+    const char *hex = line + strlen(prefix);
+
+    TEST_ASSERT_LESS_THAN(ACKS_MAX, session->ackCount);
+    for (unsigned char i = 0; i < PROVISION_ACK_SIZE; i++) TEST_ASSERT_EQUAL(1, sscanf(&hex[2 * i], "%2x", &payload[i]));
+
+    ack_t *ack = &session->acks[session->ackCount++];
+    ack->type = payload[0];
+    ack->batch = payload[1];
+    ack->status = payload[2];
+    ack->applied = payload[3] | payload[4] << 8;
+    ack->failed = payload[5] | payload[6] << 8;
+  }
+}
+
+//Returns 1 if the probe opened the door
+bool sessionGranted(const session_t *session, unsigned int probe)
+{
+  unsigned long time = PROBE_START + probe * PROBE_GAP;
+  return simCount(session->output, "pin 17 high", time, time + PROBE_GAP) != 0;
+}
+
+void sessionEnd(session_t *session)
+{
+  free(session->output);
+  session->output = 0;
+}
+
+void checkAck(const ack_t *ack, unsigned char type, unsigned char batch, unsigned char status, unsigned int applied, unsigned int failed)
+{
+  TEST_ASSERT_EQUAL_HEX8(type, ack->type);
+  TEST_ASSERT_EQUAL_HEX8(batch, ack->batch);
+  TEST_ASSERT_EQUAL(status, ack->status);
+  TEST_ASSERT_EQUAL(applied, ack->applied);
+  TEST_ASSERT_EQUAL(failed, ack->failed);
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_valid_frames);
+  RUN_TEST(test_bad_crc);
+  RUN_TEST(test_bad_length);
+  RUN_TEST(test_truncated_frame);
+  return UNITY_END();
+}
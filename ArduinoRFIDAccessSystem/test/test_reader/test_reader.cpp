@@ -0,0 +1,130 @@
+//==================== Includes ====================
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unity.h>
+#include "hal.h"
+#include "simRun.h"
+
+/*
+  MFRC522 transactions per scenario, counted by the reader mock of the
+  simulator from a mark line on: every tick wakes the field once, a Tag
+  is selected and its master block authenticated and read once per
+  presence, however long it is held; the UID comes with the select.
+*/
+
+//==================== Defines ====================
+
+/*Main loop period in ms, one wake-up per tick and reader*/
+#define TICK 10
+
+/*Tags: a stranger and a 7 byte UID*/
+#define STRANGER "0A0B0C0D"
+#define STRANGER_LONG "04A1B2C3D4E5F6"
+
+//==================== Objects ====================
+
+/*struct for the reader calls of a run*/
+typedef struct
+{
+  unsigned long wakeups;
+  unsigned long selects;
+  unsigned long blockReads;
+  double spi;                   // Register accesses per decision
+} readerCalls_t;
+
+//==================== Function Prototypes ====================
+
+readerCalls_t readerRun(const char *trace);
+
+//==================== Tests ====================
+
+//An empty field costs one wake-up per tick and reader and nothing else
+void test_idle()
+{
+  readerCalls_t calls = readerRun(SIM_RUN_MASTER_TRACE "13000 mark\n23000 end\n");
+
+  TEST_ASSERT_UINT_WITHIN(2 * HAL_READERS, HAL_READERS * 10000 / TICK, calls.wakeups);
+  TEST_ASSERT_EQUAL(0, calls.selects);
+  TEST_ASSERT_EQUAL(0, calls.blockReads);
+}
+
+//A Tag held for 5 s is selected and read once, then only woken and halted each tick
+void test_held_tag()
+{
+  readerCalls_t calls = readerRun(SIM_RUN_MASTER_TRACE "13000 mark\n14000 tag " STRANGER "\n19000 none\n20000 end\n");
+
+  TEST_ASSERT_UINT_WITHIN(2 * HAL_READERS, HAL_READERS * 7000 / TICK, calls.wakeups);
+  TEST_ASSERT_EQUAL(1, calls.selects);
+  TEST_ASSERT_EQUAL(1, calls.blockReads);
+}
+
+//The Master held to open keying is classified once as well
+void test_held_master()
+{
+  readerCalls_t calls = readerRun(SIM_RUN_MASTER_TRACE "13000 mark\n14000 tag " SIM_RUN_MASTER " master\n17000 none\n18000 end\n");
+
+  TEST_ASSERT_EQUAL(1, calls.selects);
+  TEST_ASSERT_EQUAL(1, calls.blockReads);
+}
+
+//Each presence is one select and one read, also for long UIDs (one select, more cascade levels)
+void test_each_presence()
+{
+  readerCalls_t calls = readerRun(SIM_RUN_MASTER_TRACE "13000 mark\n14000 tag " STRANGER "\n14300 none\n"
+    "15000 tag " STRANGER_LONG "\n15300 none\n16000 tag " STRANGER "\n18000 none\n19000 end\n");
+
+  TEST_ASSERT_EQUAL(3, calls.selects);
+  TEST_ASSERT_EQUAL(3, calls.blockReads);
+}
+
+//From arrival to decision the reader is woken, selected and read once, a few ticks of polls at most
+void test_spi_per_decision()
+{
+  readerCalls_t calls = readerRun(SIM_RUN_MASTER_TRACE "13000 mark\n14000 tag " STRANGER "\n14300 none\n"
+    "15000 tag " STRANGER "\n15300 none\n16000 end\n");
+
+  // Wake-up 16, select 38, read 44 and release 26 register accesses, see src/hal_native.cpp
+  TEST_ASSERT_GREATER_THAN(0, calls.spi);
+  TEST_ASSERT_TRUE(calls.spi < 16 + 38 + 44 + 26 + 2 * 16);
+}
+
+//==================== Helpers ====================
+
+//Runs a trace and reads the reader calls from the statistics
+readerCalls_t readerRun(const char *trace)
+{
+  readerCalls_t calls = {0};
+  int status;
+  char *output = simRun("-q", trace, &status);
+  const char *line = strstr(output, "reader wakeups ");
+
+  TEST_ASSERT_EQUAL(0, status);
+  TEST_ASSERT_NOT_NULL(line);
+  TEST_ASSERT_EQUAL(3, sscanf(line, "reader wakeups %lu selects %lu block reads %lu", &calls.wakeups, &calls.selects, &calls.blockReads));
+
+  line = strstr(output, "per decision spi ");
+  if(line) sscanf(line, "per decision spi %lf", &calls.spi);
+  free(output);
+  return calls;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_idle);
+  RUN_TEST(test_held_tag);
+  RUN_TEST(test_held_master);
+  RUN_TEST(test_each_presence);
+  RUN_TEST(test_spi_per_decision);
+  return UNITY_END();
+}
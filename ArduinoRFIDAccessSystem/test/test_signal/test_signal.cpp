@@ -0,0 +1,137 @@
+//==================== Includes ====================
+
+#include <stdlib.h>
+#include <unity.h>
+#include "simRun.h"
+
+/*
+  Signal pattern player: steps keep their durations on the simulated clock
+  while the loop goes on polling, and a pattern started while another one
+  plays replaces it from its first step.
+*/
+
+//==================== Defines ====================
+
+/*Buzzer output lines, see SIGNALIZER_BUZZER and BUZZER_FREQUENCY*/
+#define BUZZER_ON "tone 14 3000"
+#define BUZZER_OFF "tone 14 off"
+
+/*Pattern steps are advanced once per loop tick of 10 ms*/
+#define TICK 10
+
+/*Steps of patternPermDenied: four times buzzer and red for 120 ms, then off for 120 ms*/
+#define DENY_STEP 120
+#define DENY_BEEPS 4
+
+/*Member added while keying, granted after keying timed out*/
+#define MEMBER "01020304"
+#define STRANGER "0A0B0C0D"
+
+//==================== Function Prototypes ====================
+
+long lastFind(const char *output, const char *event, unsigned long from, unsigned long to);
+
+//==================== Tests ====================
+
+//A stranger gets four beeps of 120 ms with the LED red, 120 ms apart
+void test_deny_pattern()
+{
+  char *output = simRun("", SIM_RUN_MASTER_TRACE "15000 tag " STRANGER "\n15100 none\n18000 end\n");
+
+  long start = simFind(output, BUZZER_ON, 15000);
+  TEST_ASSERT_GREATER_OR_EQUAL(15000, start);
+  TEST_ASSERT_LESS_THAN(15000 + 2 * TICK, start);
+
+  for (unsigned char beep = 0; beep < DENY_BEEPS; beep++)
+  {
+    unsigned long on = start + 2 * beep * DENY_STEP;
+
+    TEST_ASSERT_UINT_WITHIN(TICK, on, simFind(output, BUZZER_ON, on - TICK));
+    TEST_ASSERT_UINT_WITHIN(TICK, on + DENY_STEP, simFind(output, BUZZER_OFF, on));
+    TEST_ASSERT_EQUAL(1, simCount(output, "led 100 0 0 0", on - TICK, on + TICK));
+    TEST_ASSERT_EQUAL(1, simCount(output, "led 0 0 0 0", on + DENY_STEP - TICK, on + DENY_STEP + TICK));
+  }
+  TEST_ASSERT_EQUAL(DENY_BEEPS, simCount(output, BUZZER_ON, 15000, 18000));
+  free(output);
+}
+
+//A member opens the door for OPEN_TIME with one beep of 150 ms, the beep does not hold the door back
+void test_grant_pattern()
+{
+  char *output = simRun("", "1000 tag " SIM_RUN_MASTER " master\n1250 none\n"
+    "2000 tag " MEMBER "\n2200 none\n20000 tag " MEMBER "\n20200 none\n25000 end\n");
+
+  long open = simFind(output, "pin 17 high", 20000);
+  long beep = simFind(output, BUZZER_ON, 20000);
+  TEST_ASSERT_GREATER_OR_EQUAL(20000, open);
+  TEST_ASSERT_LESS_THAN(20000 + 2 * TICK, open);
+  TEST_ASSERT_EQUAL(open, beep);
+
+  TEST_ASSERT_UINT_WITHIN(TICK, beep + 150, simFind(output, BUZZER_OFF, beep));
+  TEST_ASSERT_UINT_WITHIN(TICK, open + 3000, simFind(output, "pin 17 low", open));
+  TEST_ASSERT_EQUAL(1, simCount(output, BUZZER_ON, 20000, 25000));
+  free(output);
+}
+
+//A second stranger while the first pattern plays restarts it, the buzzer carries on without a gap
+void test_restart_on_overlap()
+{
+  char *output = simRun("", SIM_RUN_MASTER_TRACE
+    "15000 tag " STRANGER "\n15100 none\n15300 tag " STRANGER "\n15400 none\n18000 end\n");
+
+  long first = simFind(output, BUZZER_ON, 15000);
+  long last = lastFind(output, BUZZER_OFF, 15000, 18000);
+
+  // Restarted at 15300 in its second beep, the pattern ends a full pattern later
+  TEST_ASSERT_GREATER_OR_EQUAL(15300 + (2 * DENY_BEEPS - 1) * DENY_STEP - TICK, last);
+  TEST_ASSERT_LESS_THAN(15300 + (2 * DENY_BEEPS - 1) * DENY_STEP + 3 * TICK, last);
+  TEST_ASSERT_GREATER_THAN(first + (2 * DENY_BEEPS - 1) * DENY_STEP + TICK, last);
+
+  // The beep sounding at the restart is stretched, not cut
+  TEST_ASSERT_EQUAL(0, simCount(output, BUZZER_OFF, 15300, 15300 + DENY_STEP));
+  TEST_ASSERT_EQUAL(DENY_BEEPS + 1, simCount(output, BUZZER_OFF, 15000, 18000));
+  free(output);
+}
+
+//The loop keeps polling while a pattern plays: a Tag leaving and a new one are seen within ticks
+void test_poll_while_signalling()
+{
+  char *output = simRun("", "1000 tag " SIM_RUN_MASTER " master\n1250 none\n"
+    "2000 tag " MEMBER "\n2200 none\n15000 tag " STRANGER "\n15050 none\n15200 tag " MEMBER "\n15400 none\n20000 end\n");
+
+  // The member is granted during the deny pattern of the stranger before
+  long open = simFind(output, "pin 17 high", 15000);
+  TEST_ASSERT_GREATER_OR_EQUAL(15200, open);
+  TEST_ASSERT_LESS_THAN(15200 + 2 * TICK, open);
+  free(output);
+}
+
+//==================== Helpers ====================
+
+//Returns the time of the last output line starting with event in [from, to), -1 if there is none
+long lastFind(const char *output, const char *event, unsigned long from, unsigned long to)
+{
+  long last = -1;
+
+  for (long time = simFind(output, event, from); time >= 0 && (unsigned long)time < to; time = simFind(output, event, time + 1))
+    last = time;
+  return last;
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_deny_pattern);
+  RUN_TEST(test_grant_pattern);
+  RUN_TEST(test_restart_on_overlap);
+  RUN_TEST(test_poll_while_signalling);
+  return UNITY_END();
+}
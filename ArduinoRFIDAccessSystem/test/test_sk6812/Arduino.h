@@ -0,0 +1,27 @@
+#ifndef ARDUINO_H_
+#define ARDUINO_H_
+
+#include <stdint.h>
+
+/*
+  Just enough of the Arduino core for the SK6812 drivers on the host. The
+  I/O registers are an array, so a driver writes to mockIo where it would
+  write to PORTx and DDRx. Pins map like on the ATmega328P boards: 0-7
+  PORTD, 8-13 PORTB, 14-19 PORTC; a port is named by the I/O address of
+  its PORTx, DDRx is the one below.
+*/
+
+#define _SFR_IO8(io) mockIo[io]
+
+#define digitalPinToPort(pin) ((pin) < 8 ? 0x0B : (pin) < 14 ? 0x05 : 0x08)
+#define digitalPinToBitMask(pin) (1 << ((pin) < 8 ? (pin) : (pin) < 14 ? (pin) - 8 : (pin) - 14))
+#define portOutputRegister(port) (&mockIo[port])
+#define portModeRegister(port) (&mockIo[(port) - 1])
+
+#define cli()
+#define sei()
+#define SREG mockIo[0x3F]
+
+extern volatile uint8_t mockIo[0x40];
+
+#endif /* ARDUINO_H_ */
@@ -0,0 +1,220 @@
+//==================== Includes ====================
+
+#include <stdint.h>
+#include <string.h>
+#include <unity.h>
+
+/*
+  Dirty tracking of the SK6812 drivers against a mocked port register:
+  the I/O registers are an array (see Arduino.h of this suite) and the
+  bit-banged byte of sk6812_send is replaced by a recorder, for the heap
+  driver and for SK6812Fixed, the one the Nano build uses. A sync without
+  a change sends nothing, a change sends the chain up to the changed pixel
+  in one frame. Between pixels, where interrupts are enabled, the recorder
+  toggles the buzzer pin on the same port like tone() does; every pixel
+  must be sent with the port as it was when it started.
+*/
+
+//==================== Defines ====================
+
+/*SK6812Fixed maps the pins of the ATmega328P, bytes are recorded instead of sent by the assembler*/
+#define __AVR_ATmega328P__
+#define SK6812_BYTE_H_
+
+/*Chain and data pin of the tests, pin 15 is PC1*/
+#define LEDS 3
+#define PIN 15
+#define PORTC_IO 0x08
+#define PIN_MASK 0x02
+
+/*Bits of PORTC set before a sync, the sender must keep them*/
+#define PORT_OTHERS 0x81
+
+/*Buzzer on PC0, toggled between pixels*/
+#define BUZZER_MASK 0x01
+
+//==================== Objects ====================
+
+/*struct for the bytes of the last frame and its masks per pixel*/
+typedef struct
+{
+  unsigned int frames;
+  bool open;                    // Bytes go to the frame of the current sync
+  unsigned char data[LEDS * 4];
+  unsigned int length;
+  volatile unsigned char *port;
+  unsigned char maskhi[LEDS];
+  unsigned char masklo[LEDS];
+} sent_t;
+
+//==================== Global Variables ====================
+
+volatile uint8_t mockIo[0x40];
+sent_t sent;
+
+//==================== Function Prototypes ====================
+
+void sk6812_send_byte(uint8_t curbyte, volatile uint8_t *port, uint8_t maskhi, uint8_t masklo);
+
+template <class chain_t>
+void syncRecorded(chain_t &chain);
+
+//==================== Drivers ====================
+
+#include "../../lib/Arduino_SK6812/SK6812.cpp"
+#include "../../lib/Arduino_SK6812/SK6812_io.cpp"
+#include "../../lib/Arduino_SK6812/SK6812Fixed.h"
+
+//==================== Tests ====================
+
+const RGBW red = {0, 100, 0, 0};
+const RGBW green = {100, 0, 0, 0};
+
+//Syncs of an unchanged chain are elided, also after writing the same color again
+template <class chain_t>
+void checkUnchanged(chain_t &chain)
+{
+  syncRecorded(chain);
+  TEST_ASSERT_EQUAL(1, sent.frames);
+  TEST_ASSERT_EQUAL(LEDS * 4, sent.length);
+
+  for (unsigned char i = 0; i < 10; i++) syncRecorded(chain);
+  chain.set_rgbw(1, chain.get_rgbw(1));
+  syncRecorded(chain);
+
+  TEST_ASSERT_EQUAL(1, sent.frames);
+  TEST_ASSERT_EQUAL(1, chain.get_syncs_sent());
+  TEST_ASSERT_EQUAL(11, chain.get_syncs_elided());
+}
+
+//A changed pixel is sent once, with the pixels before it, in one frame
+template <class chain_t>
+void checkChanged(chain_t &chain)
+{
+  syncRecorded(chain);
+  chain.set_rgbw(LEDS - 1, red);
+  syncRecorded(chain);
+  syncRecorded(chain);
+
+  TEST_ASSERT_EQUAL(2, sent.frames);
+  TEST_ASSERT_EQUAL(LEDS * 4, sent.length);
+  TEST_ASSERT_EQUAL(100, sent.data[(LEDS - 1) * 4 + 1]);
+
+  // The ones behind the last change keep what they latched
+  chain.set_rgbw(0, green);
+  chain.set_rgbw(0, red);
+  syncRecorded(chain);
+
+  TEST_ASSERT_EQUAL(3, sent.frames);
+  TEST_ASSERT_EQUAL(4, sent.length);
+  TEST_ASSERT_EQUAL(0, sent.data[0]);
+  TEST_ASSERT_EQUAL(100, sent.data[1]);
+  TEST_ASSERT_EQUAL(3, chain.get_syncs_sent());
+}
+
+//The frame goes to PORTC with only the bit of the pin toggled, keeping the buzzer as it was before each pixel; the pin is an output
+void checkPort()
+{
+  TEST_ASSERT_TRUE(sent.port == &mockIo[PORTC_IO]);
+  for (unsigned char pixel = 0; pixel < LEDS; pixel++)
+  {
+    unsigned char others = pixel % 2 ? PORT_OTHERS ^ BUZZER_MASK : PORT_OTHERS;
+
+    TEST_ASSERT_EQUAL_HEX8(others | PIN_MASK, sent.maskhi[pixel]);
+    TEST_ASSERT_EQUAL_HEX8(others, sent.masklo[pixel]);
+  }
+  TEST_ASSERT_EQUAL(PIN_MASK, mockIo[PORTC_IO - 1]);
+}
+
+void test_heap_unchanged()
+{
+  SK6812 chain(LEDS);
+  chain.set_output(PIN);
+
+  checkUnchanged(chain);
+  checkPort();
+}
+
+void test_heap_changed()
+{
+  SK6812 chain(LEDS);
+  chain.set_output(PIN);
+
+  checkChanged(chain);
+  TEST_ASSERT_EQUAL(1, chain.set_rgbw(LEDS, red));
+}
+
+void test_fixed_unchanged()
+{
+  SK6812Fixed<LEDS, PIN> chain;
+  chain.set_output();
+
+  checkUnchanged(chain);
+  checkPort();
+}
+
+void test_fixed_changed()
+{
+  SK6812Fixed<LEDS, PIN> chain;
+  chain.set_output();
+
+  checkChanged(chain);
+  TEST_ASSERT_EQUAL(1, chain.set_rgbw(LEDS, red));
+}
+
+//==================== Helpers ====================
+
+//Syncs a chain, the bytes it sends if any are the next frame
+template <class chain_t>
+void syncRecorded(chain_t &chain)
+{
+  chain.sync();
+  sent.open = 0;
+}
+
+//Keeps a byte of the frame and the masks of its pixel, which must not change within the pixel; after the last byte of a pixel toggles the buzzer
+void sk6812_send_byte(uint8_t curbyte, volatile uint8_t *port, uint8_t maskhi, uint8_t masklo)
+{
+  if (!sent.open)
+  {
+    sent.frames++;
+    sent.open = 1;
+    sent.length = 0;
+  }
+
+  unsigned int pixel = sent.length / 4;
+
+  TEST_ASSERT_TRUE(sent.length < sizeof(sent.data));
+  if (sent.length % 4 == 0)
+  {
+    sent.maskhi[pixel] = maskhi;
+    sent.masklo[pixel] = masklo;
+  }
+  TEST_ASSERT_EQUAL_HEX8(sent.maskhi[pixel], maskhi);
+  TEST_ASSERT_EQUAL_HEX8(sent.masklo[pixel], masklo);
+
+  sent.data[sent.length++] = curbyte;
+  sent.port = port;
+  if (sent.length % 4 == 0) *port ^= BUZZER_MASK;
+}
+
+void setUp()
+{
+  memset((void *)mockIo, 0, sizeof(mockIo));
+  memset(&sent, 0, sizeof(sent));
+  mockIo[PORTC_IO] = PORT_OTHERS;
+}
+
+void tearDown()
+{
+}
+
+int main(int argc, char **argv)
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_heap_unchanged);
+  RUN_TEST(test_heap_changed);
+  RUN_TEST(test_fixed_unchanged);
+  RUN_TEST(test_fixed_changed);
+  return UNITY_END();
+}
@@ -0,0 +1,6 @@
+#ifndef UTIL_DELAY_H_
+#define UTIL_DELAY_H_
+
+/*Included by SK6812.h, the drivers do not delay on the host*/
+
+#endif /* UTIL_DELAY_H_ */
@@ -0,0 +1,244 @@
+#!/usr/bin/env python3
+"""Decodes the binary frames the access system sends on its serial line.
+
+Frame: 0x7E | type | length | payload | CRC-8 (poly 0x07) over type..payload
+
+Reads a raw capture of the serial line, or the output of the native
+simulator (only its "serial <hex>" lines are used):
+
+    python3 tools/decode.py capture.bin
+    .pio/build/native/program < trace.txt | python3 tools/decode.py --sim
+    python3 tools/decode.py --port /dev/ttyUSB0    (needs pyserial)
+"""
+
+import argparse
+import sys
+
+FRAME_SYNC = 0x7E
+FRAME_TELEMETRY = 0x01
+FRAME_EVENTS = 0x02
+FRAME_PROVISION_ACK = 0x03
+FRAME_STATUS = 0x04
+FRAME_PROVISION_BEGIN = 0x10
+FRAME_PROVISION_ADD = 0x11
+FRAME_PROVISION_REMOVE = 0x12
+FRAME_PROVISION_END = 0x13
+
+EVENTS = {
+    0x1: "grant",
+    0x2: "deny",
+    0x3: "master-set",
+    0x4: "master-accept",
+    0x5: "master-reject",
+    0x6: "add",
+    0x7: "add-full",
+    0x8: "remove",
+    0x9: "reset-whitelist",
+    0xA: "reset-master",
+    0xB: "provision",
+}
+
+EVENT_PROVISION = 0xB
+
+PROVISION_FRAMES = {
+    FRAME_PROVISION_BEGIN: "begin",
+    FRAME_PROVISION_ADD: "add",
+    FRAME_PROVISION_REMOVE: "remove",
+    FRAME_PROVISION_END: "end",
+}
+
+PROVISION_STATUS = {
+    0: "ok",
+    1: "locked",
+    2: "malformed",
+    3: "full",
+}
+
+PROBES = {
+    1: "tagPresent",
+    2: "readTag",
+    3: "lookup",
+    4: "store",
+    5: "led",
+}
+
+EVENT_RECORD_HEADER = 7
+NO_READER = 0xFF
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+def u16(data, offset):
+    return data[offset] | data[offset + 1] << 8
+
+
+def u32(data, offset):
+    return u16(data, offset) | u16(data, offset + 2) << 16
+
+
+def decode_events(payload, state):
+    # Records are as long as their UID, a UID size of 0 is followed by 4 bytes of head
+    records = []
+    offset = 3
+    while offset + EVENT_RECORD_HEADER <= len(payload):
+        size = payload[offset + 4] >> 4
+        records.append((offset, size))
+        offset += EVENT_RECORD_HEADER + (size or 4)
+    if len(payload) < 3 or offset != len(payload):
+        return ["events: bad length %d" % len(payload)]
+
+    lines = []
+    sequence = u16(payload, 0)
+    if state.get("sequence") is not None and sequence != (state["sequence"] + 1) & 0xFFFF:
+        lines.append("events: frames lost before sequence %d" % sequence)
+    state["sequence"] = sequence
+    if payload[2]:
+        lines.append("events: %d records dropped" % payload[2])
+
+    for offset, size in records:
+        time = u32(payload, offset)
+        info = payload[offset + 4]
+        latency = payload[offset + 5]
+        reader = payload[offset + 6]
+        data = payload[offset + EVENT_RECORD_HEADER:offset + EVENT_RECORD_HEADER + (size or 4)]
+        uid = data.hex().upper() if size else "-"
+        if info & 0x0F == EVENT_PROVISION:
+            uid = "%d UIDs" % u32(data, 0)
+        lines.append("%10d %-15s reader %s uid %-20s latency %s ms" % (
+            time, EVENTS.get(info & 0x0F, "event-%d" % (info & 0x0F)),
+            "-" if reader == NO_READER else reader, uid, ">=255" if latency == 0xFF else latency))
+    return lines
+
+
+def decode_telemetry(payload, state):
+    if len(payload) < 2 or len(payload) != 2 + 3 * payload[0]:
+        return ["telemetry: bad length %d" % len(payload)]
+
+    lines = ["telemetry: %d samples, %d dropped" % (payload[0], payload[1])]
+    for offset in range(2, len(payload), 3):
+        duration = u16(payload, offset + 1)
+        lines.append("  %-12s %s us" % (
+            PROBES.get(payload[offset], "probe-%d" % payload[offset]),
+            ">=65535" if duration == 0xFFFF else duration))
+    return lines
+
+
+def decode_provision_ack(payload, state):
+    if len(payload) != 11:
+        return ["provision: bad length %d" % len(payload)]
+
+    applied = u16(payload, 3)
+    failed = u16(payload, 5)
+    elapsed = u32(payload, 7)
+    rate = "%.1f UIDs/s" % (applied * 1000.0 / elapsed) if elapsed else "-"
+    return ["provision: %-6s batch %3d %-9s applied %d failed %d in %d ms, %s" % (
+        PROVISION_FRAMES.get(payload[0], "0x%02X" % payload[0]), payload[1],
+        PROVISION_STATUS.get(payload[2], "status-%d" % payload[2]), applied, failed, elapsed, rate)]
+
+
+def decode_status(payload, state):
+    if len(payload) != 24:
+        return ["status: bad length %d" % len(payload)]
+
+    free = u16(payload, 4)
+    hits = u32(payload, 8)
+    lookups = hits + u32(payload, 12)
+    elided = u32(payload, 20)
+    syncs = u32(payload, 16) + elided
+    return ["status: boot %d us, free SRAM %s, %d members" % (
+        u32(payload, 0), "%d bytes" % free if free else "unknown", u16(payload, 6)),
+        "status: grant cache hits %d of %d (%s)" % (
+        hits, lookups, "%.1f%%" % (100.0 * hits / lookups) if lookups else "-"),
+        "status: LED syncs elided %d of %d (%s)" % (
+        elided, syncs, "%.1f%%" % (100.0 * elided / syncs) if syncs else "-")]
+
+
+DECODERS = {
+    FRAME_TELEMETRY: decode_telemetry,
+    FRAME_EVENTS: decode_events,
+    FRAME_PROVISION_ACK: decode_provision_ack,
+    FRAME_STATUS: decode_status,
+}
+
+
+def frames(stream):
+    """Yields (type, payload) of every valid frame, resynchronises on errors."""
+    buffer = bytearray()
+    for chunk in stream:
+        buffer += chunk
+        while True:
+            start = buffer.find(bytes([FRAME_SYNC]))
+            if start < 0:
+                buffer.clear()
+                break
+            del buffer[:start]
+            if len(buffer) < 3 or len(buffer) < 4 + buffer[2]:
+                break
+            end = 3 + buffer[2]
+            if crc8(buffer[1:end]) != buffer[end]:
+                # Sync byte inside data, try the next one
+                del buffer[:1]
+                continue
+            yield buffer[1], bytes(buffer[3:end])
+            del buffer[:end + 1]
+
+
+def sim_chunks(lines):
+    for line in lines:
+        fields = line.split()
+        if len(fields) == 3 and fields[1] == "serial":
+            yield bytes.fromhex(fields[2])
+
+
+def file_chunks(handle):
+    while True:
+        chunk = handle.read(256)
+        if not chunk:
+            return
+        yield chunk
+
+
+def port_chunks(name, baud):
+    import serial
+    port = serial.Serial(name, baud, timeout=1)
+    while True:
+        chunk = port.read(256)
+        if chunk:
+            yield chunk
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("capture", nargs="?", help="raw capture file, stdin if omitted")
+    parser.add_argument("--sim", action="store_true", help="input is simulator output")
+    parser.add_argument("--port", help="read from a serial port instead")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    if args.port:
+        chunks = port_chunks(args.port, args.baud)
+    elif args.sim:
+        chunks = sim_chunks(open(args.capture) if args.capture else sys.stdin)
+    else:
+        chunks = file_chunks(open(args.capture, "rb") if args.capture else sys.stdin.buffer)
+
+    state = {}
+    for frame_type, payload in frames(chunks):
+        decoder = DECODERS.get(frame_type)
+        if decoder is None:
+            print("frame type 0x%02X, %d bytes" % (frame_type, len(payload)))
+            continue
+        for line in decoder(payload, state):
+            print(line)
+        sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+"""Streams Whitelist UIDs to the access system, see include/provision.h.
+
+UID files hold one UID per line as hex (4, 7 or 10 bytes), # starts a
+comment. Keying must be open: present the Master before starting.
+
+    python3 tools/provision.py --port /dev/ttyUSB0 --add users.txt
+    python3 tools/provision.py --port /dev/ttyUSB0 --add new.txt --remove gone.txt
+    python3 tools/provision.py --port /dev/ttyUSB0 --replace --add users.txt
+
+With --sim a trace for the native simulator is written instead; it
+presents the Master, then sends each frame once the previous one was
+acknowledged:
+
+    python3 tools/provision.py --sim --master A0B0C0D0 --add users.txt > trace.txt
+    .pio/build/native/program < trace.txt | python3 tools/decode.py --sim
+"""
+
+import argparse
+import sys
+import time
+
+from decode import (FRAME_PROVISION_ACK, FRAME_PROVISION_ADD, FRAME_PROVISION_BEGIN,
+                    FRAME_PROVISION_END, FRAME_PROVISION_REMOVE, FRAME_SYNC,
+                    crc8, decode_provision_ack, frames)
+
+FRAME_RX_PAYLOAD_MAX = 60
+PROVISION_REPLACE = 0x01
+PROVISION_LOCKED = 1
+
+RETRIES = 3
+
+
+def frame(frame_type, payload=b""):
+    body = bytes([frame_type, len(payload)]) + payload
+    return bytes([FRAME_SYNC]) + body + bytes([crc8(body)])
+
+
+def read_uids(name):
+    uids = []
+    with open(name) as handle:
+        for number, line in enumerate(handle, 1):
+            text = line.split("#")[0].strip()
+            if not text:
+                continue
+            uid = bytes.fromhex(text)
+            if len(uid) not in (4, 7, 10):
+                sys.exit("%s:%d: UID must have 4, 7 or 10 bytes" % (name, number))
+            uids.append(uid)
+    return uids
+
+
+def batches(frame_type, uids):
+    """Packs UIDs into as few frames as the receive buffer allows."""
+    batch = 0
+    payload = bytearray([batch])
+    for uid in uids:
+        if len(payload) + 1 + len(uid) > FRAME_RX_PAYLOAD_MAX:
+            yield frame(frame_type, bytes(payload))
+            batch = (batch + 1) & 0xFF
+            payload = bytearray([batch])
+        payload += bytes([len(uid)]) + uid
+    if len(payload) > 1:
+        yield frame(frame_type, bytes(payload))
+
+
+def session(args):
+    flags = PROVISION_REPLACE if args.replace else 0
+    yield frame(FRAME_PROVISION_BEGIN, bytes([flags]))
+    for name in args.remove or []:
+        yield from batches(FRAME_PROVISION_REMOVE, read_uids(name))
+    for name in args.add or []:
+        yield from batches(FRAME_PROVISION_ADD, read_uids(name))
+    yield frame(FRAME_PROVISION_END)
+
+
+def write_trace(args):
+    # Master in and out of the field opens keying, the frames follow once it is open
+    out = sys.stdout
+    out.write("# provisioning session, generated by tools/provision.py\n")
+    out.write("1000 tag %s master\n1300 none\n" % args.master)
+    for data in session(args):
+        out.write("2000 serial %s\n2000 wait %02X\n" % (data.hex().upper(), FRAME_PROVISION_ACK))
+    out.write("2000 end\n")
+
+
+def receive(port, timeout):
+    deadline = time.monotonic() + timeout
+    while time.monotonic() < deadline:
+        yield port.read(port.in_waiting or 1)
+
+
+def stream(args):
+    import serial
+    port = serial.Serial(args.port, args.baud, timeout=0.1)
+
+    start = time.monotonic()
+    ack = None
+    for data in session(args):
+        batched = data[1] in (FRAME_PROVISION_ADD, FRAME_PROVISION_REMOVE)
+        for attempt in range(RETRIES):
+            port.write(data)
+            ack = next((payload for frame_type, payload in frames(receive(port, args.timeout))
+                        if frame_type == FRAME_PROVISION_ACK and payload[0] == data[1]
+                        and (not batched or payload[1] == data[3])), None)
+            if ack is not None:
+                break
+        else:
+            sys.exit("no acknowledge for frame type 0x%02X" % data[1])
+
+        print(decode_provision_ack(ack, {})[0])
+        if ack[2] == PROVISION_LOCKED:
+            sys.exit("keying is not open, present the Master first")
+
+    wall = time.monotonic() - start
+    applied = ack[3] | ack[4] << 8
+    print("%d UIDs in %.1f s including the serial line: %.1f UIDs/s" % (applied, wall, applied / wall if wall else 0))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--add", action="append", help="file of UIDs to add")
+    parser.add_argument("--remove", action="append", help="file of UIDs to remove")
+    parser.add_argument("--replace", action="store_true", help="empty the Whitelist first")
+    parser.add_argument("--port", help="serial port of the access system")
+    parser.add_argument("--baud", type=int, default=115200)
+    parser.add_argument("--timeout", type=float, default=2.0, help="seconds to wait for an acknowledge")
+    parser.add_argument("--sim", action="store_true", help="write a simulator trace to stdout")
+    parser.add_argument("--master", default="A0B0C0D0", help="Master UID used in the simulator trace")
+    args = parser.parse_args()
+
+    if args.sim:
+        write_trace(args)
+    elif args.port:
+        stream(args)
+    else:
+        parser.error("either --port or --sim is needed")
+
+
+if __name__ == "__main__":
+    main()